@@ -0,0 +1,71 @@
+// EPOS Alarm Benchmark
+
+// Arms, re-arms and cancels thousands of alarms, as protocol stacks do with
+// retransmission timeouts, to compare the relative queue with the hashed
+// timing wheel (see Traits<Alarm>::wheel), and then checks that a smaller set
+// of short alarms expires as expected.
+
+#include <utility/ostream.h>
+#include <time.h>
+
+using namespace EPOS;
+
+const unsigned int ALARMS = 2000;
+const unsigned int EXPIRING = 100;
+
+// Alarms are constructed in place, so the heap does not disturb measurements
+static char buffer[ALARMS * sizeof(Alarm)] __attribute__((aligned(8)));
+static Alarm * const alarms = reinterpret_cast<Alarm *>(buffer);
+
+volatile unsigned int fired;
+
+OStream cout;
+
+void expire() { fired++; }
+
+// Timeouts spread between 1 and 11 s, in no particular order
+Microsecond timeout(unsigned int i) { return ((i * 7919) % 10000 + 1000) * 1000; }
+
+void report(const char * phase, Chronometer & chrono)
+{
+    cout << phase << ": " << chrono.read() << " us (" << chrono.read() * 1000 / ALARMS << " ns/alarm)" << endl;
+}
+
+int main()
+{
+    cout << "Alarm Benchmark (" << ALARMS << " alarms, " << (Traits<Alarm>::wheel ? "timing wheel" : "relative queue") << ")" << endl;
+
+    Function_Handler handler(&expire);
+    Chronometer chrono;
+
+    chrono.start();
+    for(unsigned int i = 0; i < ALARMS; i++)
+        new (&alarms[i]) Alarm(timeout(i), &handler);
+    chrono.stop();
+    report("arm", chrono);
+
+    chrono.reset();
+    chrono.start();
+    for(unsigned int i = 0; i < ALARMS; i++)
+        alarms[i].reset();
+    chrono.stop();
+    report("rearm", chrono);
+
+    chrono.reset();
+    chrono.start();
+    for(unsigned int i = 0; i < ALARMS; i++)
+        alarms[i].~Alarm();
+    chrono.stop();
+    report("cancel", chrono);
+
+    fired = 0;
+    for(unsigned int i = 0; i < EXPIRING; i++)
+        new (&alarms[i]) Alarm((i % 10 + 1) * 10000, &handler);
+    Delay wait(200000);
+    for(unsigned int i = 0; i < EXPIRING; i++)
+        alarms[i].~Alarm();
+
+    cout << "expired: " << fired << "/" << EXPIRING << (fired == EXPIRING ? " (ok)" : " (FAILED)") << endl;
+
+    return 0;
+}
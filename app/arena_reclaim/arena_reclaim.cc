@@ -0,0 +1,99 @@
+// EPOS Arena Reclaim Test Program
+
+// Fills arenas with small objects and checks, through the application's heap
+// profile (Traits<Heaps>::profiled), that reset() reuses the arena's chunks
+// instead of taking more from the heap, that a Scope rolls the arena back to
+// where it started and that release() and ~Arena() give every chunk back.
+// Arenas are also created and destroyed many more times than the heap could
+// hold them, so memory that is not reclaimed ends up exhausting the heap,
+// which panics.
+
+#include <utility/ostream.h>
+#include <utility/arena.h>
+
+using namespace EPOS;
+
+const unsigned int CHUNK = 4096;
+const unsigned int OBJECTS = 1000;
+const unsigned int ROUNDS = 100;
+const unsigned int ARENAS = 2 * Traits<Application>::HEAP_SIZE / (OBJECTS * sizeof(unsigned long long)) + 1;
+
+OStream cout;
+
+unsigned int errors;
+
+void check(bool ok, const char * what)
+{
+    if(!ok) {
+        cout << "Failed: " << what << "!" << endl;
+        errors++;
+    }
+}
+
+unsigned long live() { return Application::heap_profile().live; }
+
+// Returns the first object
+unsigned long long * fill(Arena & arena)
+{
+    unsigned long long * first = new (arena) unsigned long long(0);
+    for(unsigned int i = 1; i < OBJECTS; i++)
+        new (arena) unsigned long long(i);
+    return first;
+}
+
+int main()
+{
+    cout << "Arena Reclaim Test (" << OBJECTS << " objects, " << ROUNDS << " rounds, " << ARENAS << " arenas)" << endl;
+
+    unsigned long base = live();
+
+    {
+        Arena arena(CHUNK);
+
+        // Resets keep the chunks, so refilling the arena takes nothing from the heap
+        unsigned long long * first = fill(arena);
+        unsigned int capacity = arena.capacity();
+        unsigned long used = live();
+        check(capacity >= OBJECTS * sizeof(unsigned long long), "the arena couldn't hold its objects");
+        for(unsigned int i = 0; i < ROUNDS; i++) {
+            arena.reset();
+            check(fill(arena) == first, "reset() didn't rewind the arena");
+        }
+        check(arena.capacity() == capacity, "reset() didn't reuse the arena's chunks");
+        check(live() == used, "the heap grew across resets");
+
+        // A Scope releases what was allocated within it, even across chunks
+        arena.reset();
+        fill(arena);
+        char * mark;
+        {
+            Arena::Scope scope(arena);
+            mark = new (arena) char('a');
+            fill(arena);
+            fill(arena);
+        }
+        check(new (arena) char('b') == mark, "the Scope didn't roll the arena back");
+        check(live() > used, "the arena didn't grow to hold three fills");
+
+        // Bulk release gives every chunk back to the heap
+        arena.release();
+        check(arena.capacity() == 0, "release() kept chunks");
+        check(live() == base, "release() didn't return the chunks to the heap");
+
+        fill(arena);
+        check(arena.capacity() == capacity, "the arena wasn't refilled after release()");
+    }
+    check(live() == base, "~Arena() didn't return the chunks to the heap");
+
+    // Twice as much memory as the heap holds goes through these arenas
+    for(unsigned int i = 0; i < ARENAS; i++) {
+        Arena arena(CHUNK);
+        fill(arena);
+    }
+    check(live() == base, "destroyed arenas left memory behind");
+
+    if(!errors)
+        cout << "Passed!" << endl;
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+// EPOS Condition Handoff Test Program
+
+// A consumer waits on a condition while a higher-priority producer is blocked
+// on the monitor's mutex, so Condition::wait() hands the mutex over to the
+// producer, which signals right away. If the consumer could be preempted
+// before reaching the condition's queue, that signal would be lost and the
+// test would hang (reported by the watchdog Alarm).
+
+#include <utility/ostream.h>
+#include <time.h>
+#include <synchronizer.h>
+#include <process.h>
+
+using namespace EPOS;
+
+const unsigned int ITERATIONS = 100;
+const unsigned int WATCHDOG = 5000000; // us
+
+OStream cout;
+
+Mutex mutex;
+Condition produced;
+Semaphore go(0);
+volatile bool full;
+volatile unsigned int item;
+volatile bool done;
+
+int producer()
+{
+    for(unsigned int i = 0; i < ITERATIONS; i++) {
+        go.p();
+        mutex.lock(); // handed over by the consumer's wait()
+        item = i;
+        full = true;
+        produced.signal();
+        mutex.unlock();
+    }
+
+    return 0;
+}
+
+void watchdog()
+{
+    if(!done)
+        cout << "Failed: the consumer missed a signal() and is still waiting!" << endl;
+}
+
+int main()
+{
+    cout << "Condition Handoff Test (" << ITERATIONS << " iterations)" << endl;
+
+    Function_Handler handler(&watchdog);
+    Alarm alarm(WATCHDOG, &handler);
+
+    Thread * prod = new Thread(Thread::Configuration(Thread::READY, Thread::HIGH), &producer);
+
+    unsigned int errors = 0;
+    for(unsigned int i = 0; i < ITERATIONS; i++) {
+        mutex.lock();
+        go.v(); // the producer preempts this thread and blocks on the mutex
+        while(!full)
+            produced.wait(&mutex);
+        if(item != i)
+            errors++;
+        full = false;
+        mutex.unlock();
+    }
+    done = true;
+
+    prod->join();
+    delete prod;
+
+    if(errors)
+        cout << "Failed: " << errors << " items out of order!" << endl;
+    else
+        cout << "Passed!" << endl;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+// EPOS Heap Benchmark
+
+// Measures the latency of alloc() and free(), in TSC ticks, of the first-fit
+// heap (Simple_Heap) and the TLSF heap under the same random workload. Half
+// of the live blocks are then released, leaving the heaps fragmented, and the
+// allocation of blocks larger than any hole shows the worst case of each.
+
+#include <utility/ostream.h>
+#include <utility/heap.h>
+#include <architecture/tsc.h>
+
+using namespace EPOS;
+
+const unsigned int HEAP_SIZE = 256 * 1024;
+const unsigned int OPERATIONS = 20000;
+const unsigned int LIVE = 256;
+const unsigned int LARGE = 8;
+
+typedef TSC::Time_Stamp Time_Stamp;
+
+static char simple_pool[HEAP_SIZE] __attribute__((aligned(8)));
+static char tlsf_pool[HEAP_SIZE] __attribute__((aligned(8)));
+
+OStream cout;
+
+// Latency statistics
+struct Latency {
+    Latency(): min(~0ULL), max(0), total(0), count(0) {}
+
+    void sample(const Time_Stamp & t) {
+        if(t < min)
+            min = t;
+        if(t > max)
+            max = t;
+        total += t;
+        count++;
+    }
+
+    Time_Stamp min;
+    Time_Stamp max;
+    Time_Stamp total;
+    unsigned int count;
+};
+
+OStream & operator<<(OStream & os, const Latency & l)
+{
+    os << "min=" << l.min << ", avg=" << (l.count ? l.total / l.count : 0) << ", max=" << l.max;
+    return os;
+}
+
+// Deterministic, so both heaps see exactly the same sequence
+unsigned int seed;
+unsigned int random() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; }
+
+// Mostly small blocks, with a few up to 4 KB
+unsigned int size() { return (random() % 4) ? random() % 128 + 8 : random() % 4096 + 8; }
+
+template<typename H>
+void benchmark(const char * name, H & heap)
+{
+    void * live[LIVE];
+    Latency alloc, release, large;
+
+    seed = 1;
+    for(unsigned int i = 0; i < LIVE; i++)
+        live[i] = 0;
+
+    for(unsigned int i = 0; i < OPERATIONS; i++) {
+        unsigned int j = random() % LIVE;
+        Time_Stamp t = TSC::time_stamp();
+        if(live[j]) {
+            heap.free(live[j]);
+            release.sample(TSC::time_stamp() - t);
+            live[j] = 0;
+        } else {
+            live[j] = heap.alloc(size());
+            alloc.sample(TSC::time_stamp() - t);
+        }
+    }
+
+    // Fragment the heap and ask for more than any hole can hold
+    for(unsigned int i = 0; i < LIVE; i += 2)
+        if(live[i]) {
+            heap.free(live[i]);
+            live[i] = 0;
+        }
+    void * blocks[LARGE];
+    for(unsigned int i = 0; i < LARGE; i++) {
+        Time_Stamp t = TSC::time_stamp();
+        blocks[i] = heap.alloc(8192);
+        large.sample(TSC::time_stamp() - t);
+    }
+
+    for(unsigned int i = 0; i < LARGE; i++)
+        heap.free(blocks[i]);
+    for(unsigned int i = 0; i < LIVE; i++)
+        if(live[i])
+            heap.free(live[i]);
+
+    cout << name << ":" << endl;
+    cout << "  alloc: " << alloc << endl;
+    cout << "  free: " << release << endl;
+    cout << "  large alloc (fragmented): " << large << endl;
+}
+
+int main()
+{
+    cout << "Heap Benchmark (" << OPERATIONS << " operations, " << LIVE << " live blocks at most, latency in TSC ticks at " << TSC::frequency() << " Hz)" << endl;
+
+    Simple_Heap simple(simple_pool, HEAP_SIZE);
+    benchmark("First-fit (Grouping_List)", simple);
+
+    TLSF_Heap tlsf(tlsf_pool, HEAP_SIZE);
+    benchmark("TLSF", tlsf);
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+// EPOS Heap Tags Test Program
+
+// Objects are allocated with new (SYSTEM), new (UNCACHED), new (heap) and
+// plain new, and released with plain delete. Every heap's profile (see
+// Traits<Heaps>::profiled) must show the object while it lives and nothing
+// after delete, which must return each block to the heap it came from
+// instead of to the application's heap.
+
+#include <utility/ostream.h>
+#include <system.h>
+
+using namespace EPOS;
+
+const unsigned int POOL_SIZE = 16 * 1024;
+
+static char pool[POOL_SIZE] __attribute__((aligned(8)));
+
+OStream cout;
+
+unsigned int errors;
+
+struct Object {
+    Object(): value(0x5a5a5a5a) {}
+
+    unsigned int value;
+    char data[100];
+};
+
+struct Usage {
+    Usage(Heap * h): system(System::heap_profile().live), uncached(System::uncached_heap_profile().live),
+        application(Application::heap_profile().live), local(h->profile().live) {}
+
+    bool operator==(const Usage & h) const { return (system == h.system) && (uncached == h.uncached) && (application == h.application) && (local == h.local); }
+
+    unsigned long system;
+    unsigned long uncached;
+    unsigned long application;
+    unsigned long local;
+};
+
+OStream & operator<<(OStream & os, const Usage & h)
+{
+    os << "{system=" << h.system << ",uncached=" << h.uncached << ",application=" << h.application << ",local=" << h.local << "}";
+    return os;
+}
+
+// Exactly the heap at "which" must have grown while the object lived
+void check(const char * name, const Usage & before, const Usage & during, const Usage & after, unsigned long Usage::* which)
+{
+    bool ok = (after == before) && (during.*which > before.*which);
+    Usage others = during;
+    others.*which = before.*which;
+    ok = ok && (others == before);
+
+    cout << name << ": before=" << before << ", during=" << during << ", after=" << after << (ok ? " (ok)" : " (FAILED)") << endl;
+    if(!ok)
+        errors++;
+}
+
+template<typename A>
+void object(const char * name, const A & allocator, Heap * heap, unsigned long Usage::* which)
+{
+    Usage before(heap);
+    Object * o = new (allocator) Object;
+    Usage during(heap);
+    delete o;
+    check(name, before, during, Usage(heap), which);
+}
+
+template<typename A>
+void array(const char * name, const A & allocator, Heap * heap, unsigned long Usage::* which)
+{
+    Usage before(heap);
+    Object * o = new (allocator) Object[4];
+    Usage during(heap);
+    delete[] o;
+    check(name, before, during, Usage(heap), which);
+}
+
+int main()
+{
+    cout << "Heap Tags Test" << endl;
+
+    Heap heap(pool, POOL_SIZE);
+
+    object("new (SYSTEM)", SYSTEM, &heap, &Usage::system);
+    array("new (SYSTEM) []", SYSTEM, &heap, &Usage::system);
+    object("new (UNCACHED)", UNCACHED, &heap, &Usage::uncached);
+    array("new (UNCACHED) []", UNCACHED, &heap, &Usage::uncached);
+    object("new (heap)", &heap, &heap, &Usage::local);
+    array("new (heap) []", &heap, &heap, &Usage::local);
+
+    {
+        Usage before(&heap);
+        Object * o = new Object;
+        Usage during(&heap);
+        delete o;
+        check("new", before, during, Usage(&heap), &Usage::application);
+    }
+
+    // kfree() and free() also follow the tags
+    {
+        Usage before(&heap);
+        void * p = new (UNCACHED) Object;
+        void * q = new (&heap) Object;
+        Usage during(&heap);
+        kfree(p);
+        free(q);
+        bool ok = (Usage(&heap) == before) && (during.uncached > before.uncached) && (during.local > before.local);
+        cout << "kfree() and free(): " << (ok ? "ok" : "FAILED") << endl;
+        if(!ok)
+            errors++;
+    }
+
+    if(!errors)
+        cout << "Passed!" << endl;
+
+    return 0;
+}
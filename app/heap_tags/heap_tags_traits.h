@@ -0,0 +1,202 @@
+#ifndef __traits_h
+#define __traits_h
+
+#include <system/config.h>
+
+__BEGIN_SYS
+
+// Build
+template<> struct Traits<Build>: public Traits_Tokens
+{
+    // Basic configuration
+    static const unsigned int MODE = LIBRARY;
+    static const unsigned int ARCHITECTURE = RV32;
+    static const unsigned int MACHINE = RISCV;
+    static const unsigned int MODEL = SiFive_E;
+    static const unsigned int CPUS = 1;
+    static const unsigned int NODES = 1; // (> 1 => NETWORKING)
+    static const unsigned int EXPECTED_SIMULATION_TIME = 60; // s (0 => not simulated)
+
+    // Default flags
+    static const bool enabled = true;
+    static const bool monitored = false;
+    static const bool debugged = true;
+    static const bool hysterically_debugged = false;
+
+    // Default aspects
+    typedef ALIST<> ASPECTS;
+};
+
+
+// Utilities
+template<> struct Traits<Debug>: public Traits<Build>
+{
+    static const bool error   = true;
+    static const bool warning = true;
+    static const bool info    = false;
+    static const bool trace   = false;
+};
+
+template<> struct Traits<Lists>: public Traits<Build>
+{
+    static const bool debugged = hysterically_debugged;
+};
+
+template<> struct Traits<Spin>: public Traits<Build>
+{
+    static const bool debugged = hysterically_debugged;
+};
+
+template<> struct Traits<Heaps>: public Traits<Build>
+{
+    static const bool debugged = hysterically_debugged;
+
+    // Two-level segregated fit (bounded-time) instead of first-fit allocation
+    static const bool tlsf = false;
+
+    // Segregated free lists (16 to 2048 bytes) carved in slabs of SLAB_SIZE
+    // bytes from the heap, which serves larger blocks
+    static const bool slab = true;
+    static const unsigned int SLAB_SIZE = 4096;
+
+    // Objects of each size class cached per CPU on multicores (batches of half
+    // of it move between caches and the shared heap)
+    static const unsigned int MAGAZINE_SIZE = 16;
+
+    // Size of the chunks arenas carve from the application's heap (see Arena)
+    static const unsigned int ARENA_CHUNK = 4096;
+
+    // Collect fragmentation and latency statistics (see Slab_Heap::Statistics)
+    static const bool statistics = false;
+
+    // Account live and peak bytes, sizes and call sites of allocations, which
+    // are printed when the last thread exits (see Heap_Profiler)
+    static const bool profiled = true;
+    static const unsigned int PROFILE_SITES = 32;
+};
+
+template<> struct Traits<Observers>: public Traits<Build>
+{
+    // Some observed objects are created before initializing the Display
+    // Enabling debug may cause trouble in some Machines
+    static const bool debugged = false;
+};
+
+
+// System Parts (mostly to fine control debugging)
+template<> struct Traits<Boot>: public Traits<Build>
+{
+};
+
+template<> struct Traits<Setup>: public Traits<Build>
+{
+};
+
+template<> struct Traits<Init>: public Traits<Build>
+{
+};
+
+template<> struct Traits<Framework>: public Traits<Build>
+{
+};
+
+template<> struct Traits<Aspect>: public Traits<Build>
+{
+    static const bool debugged = hysterically_debugged;
+};
+
+
+__END_SYS
+
+// Mediators
+#include __ARCHITECTURE_TRAITS_H
+#include __MACHINE_TRAITS_H
+
+__BEGIN_SYS
+
+
+// API Components
+template<> struct Traits<Application>: public Traits<Build>
+{
+    static const unsigned int STACK_SIZE = Traits<Machine>::STACK_SIZE;
+    static const unsigned int HEAP_SIZE = Traits<Machine>::HEAP_SIZE;
+    static const unsigned int MAX_THREADS = Traits<Machine>::MAX_THREADS;
+};
+
+template<> struct Traits<System>: public Traits<Build>
+{
+    static const unsigned int mode = Traits<Build>::MODE;
+    static const bool multithread = (Traits<Build>::CPUS > 1) || (Traits<Application>::MAX_THREADS > 1);
+    static const bool multitask = (mode != Traits<Build>::LIBRARY);
+    static const bool multicore = (Traits<Build>::CPUS > 1) && multithread;
+    static const bool multiheap = multitask || Traits<Scratchpad>::enabled;
+
+    static const unsigned long LIFE_SPAN = 1 * YEAR; // s
+    static const unsigned int DUTY_CYCLE = 1000000; // ppm
+
+    static const bool reboot = true;
+
+    static const unsigned int STACK_SIZE = Traits<Machine>::STACK_SIZE;
+    static const unsigned int HEAP_SIZE = (Traits<Application>::MAX_THREADS + 1) * Traits<Application>::STACK_SIZE;
+    static const unsigned int UNCACHED_HEAP_SIZE = 64 * 1024; // heap for new (UNCACHED), carved from an MMU::DMA_Buffer
+};
+
+template<> struct Traits<Task>: public Traits<Build>
+{
+    static const bool enabled = Traits<System>::multitask;
+};
+
+template<> struct Traits<Thread>: public Traits<Build>
+{
+    static const bool enabled = Traits<System>::multithread;
+    static const bool smp = Traits<System>::multicore;
+    static const bool trace_idle = hysterically_debugged;
+    static const bool simulate_capacity = false;
+    static const bool multilevel = true; // O(1) ready queue for Priority-based criteria: one FIFO per priority and a bitmap of non-empty ones
+    static const bool pooled = true; // recycle the stacks of up to MAX_THREADS deleted threads for new threads with the same stack size
+    static const bool guarded = false; // detect stack overflows through canaries at the bottom of stacks, checked at every context switch
+
+    typedef RR Criterion; // multicores (CPUS > 1) require a multicore criterion, such as GRR, PEDF or GEDF
+    static const unsigned int QUANTUM = 10000; // us
+    static const unsigned int CLUSTERS = 1; // CPU clusters for clustered criteria (e.g. CEDF)
+};
+
+template<> struct Traits<Scheduler<Thread>>: public Traits<Build>
+{
+    static const bool debugged = Traits<Thread>::trace_idle || hysterically_debugged;
+};
+
+template<> struct Traits<Synchronizer>: public Traits<Build>
+{
+    static const bool enabled = Traits<System>::multithread;
+
+    // Priority inversion protocol for Mutex: NONE, INHERITANCE or CEILING (immediate)
+    static const unsigned int PRIORITY_INVERSION_PROTOCOL = INHERITANCE;
+};
+
+template<> struct Traits<Alarm>: public Traits<Build>
+{
+    static const bool visible = hysterically_debugged;
+
+    // Hashed timing wheel for alarm requests (constant-time arm and cancel)
+    // instead of a relative queue. SLOTS should exceed the number of ticks of
+    // most alarms and be a power of 2. Its handlers always run as Softirqs
+    // (see deferred), so the wheel requires them.
+    static const bool wheel = false;
+    static const unsigned int SLOTS = 256;
+
+    // Run alarm handlers as Softirqs, with interrupts enabled, when the
+    // timer's ISR returns, instead of within it
+    static const bool deferred = false;
+};
+
+template<> struct Traits<Softirq>: public Traits<Build>
+{
+    // Softirqs raised by interrupt handlers are drained by IC::dispatch()
+    static const bool enabled = true;
+};
+
+
+__END_SYS
+
+#endif
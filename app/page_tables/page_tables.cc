@@ -0,0 +1,147 @@
+// EPOS Page Tables Test Program
+
+// Builds address spaces, attaches contiguous segments mapped with megapages
+// and segments mapped with 4 KB pages to them and checks, by walking their
+// tables with physical(), that every page lands on the segment's frames, that
+// detached segments are no longer mapped and that they can be reattached at a
+// given address. Traits<System>::multitask selects the paging MMU (Sv32_MMU
+// on RV32, Sv39_MMU on RV64) in LIBRARY mode, but the tables are only built
+// and walked: the application runs in machine mode, on physical addresses,
+// so no address space is ever activated. Address spaces are also created in
+// larger numbers than there are ASIDs (Traits<MMU>::ASIDS) and, in the end,
+// every frame taken must have been given back to the MMU.
+
+#include <utility/ostream.h>
+#include <memory.h>
+
+using namespace EPOS;
+
+typedef CPU::Reg Reg;
+typedef Segment::Flags Flags;
+
+const unsigned long PAGE = sizeof(MMU::Page);
+const unsigned long MEGAPAGE = PAGE * (PAGE / sizeof(MMU::PT_Entry)); // mapped by a whole page table
+const unsigned int ADDRESS_SPACES = Traits<MMU>::ASIDS + 2;
+
+OStream cout;
+
+unsigned int errors;
+
+void check(bool ok, const char * what)
+{
+    if(!ok) {
+        cout << "Failed: " << what << "!" << endl;
+        errors++;
+    }
+}
+
+// Every page of the segment attached at "log" must be mapped to the frame at "phy" plus its offset (any frame if "phy" is null)
+bool mapped(Address_Space & as, Reg log, Reg phy, unsigned long bytes)
+{
+    for(unsigned long i = 0; i < bytes; i += PAGE) {
+        Reg frame = as.physical(log + i + 1);
+        if(!frame || ((frame & (PAGE - 1)) != 1) || (phy && (frame != phy + i + 1)))
+            return false;
+    }
+    return true;
+}
+
+bool unmapped(Address_Space & as, Reg log, unsigned long bytes)
+{
+    for(unsigned long i = 0; i < bytes; i += PAGE)
+        if(as.physical(log + i))
+            return false;
+    return true;
+}
+
+int main()
+{
+    cout << "Page Tables Test (page=" << PAGE << ", megapage=" << MEGAPAGE << ", " << ADDRESS_SPACES << " address spaces)" << endl;
+
+    unsigned int allocable = MMU::allocable();
+
+    // The master directory identity maps the memory
+    {
+        Address_Space master(MMU::current());
+        check(master.physical(&errors) == Reg(&errors), "the master directory doesn't identity map the memory");
+        check(MMU::physical(&errors) == Reg(&errors), "MMU::physical() doesn't walk the current directory");
+    }
+
+    {
+        Address_Space as;
+        Address_Space other;
+
+        // Contiguous segments of megapages need no page tables
+        Segment big(2 * MEGAPAGE, Flags::APP | Flags::CT);
+        check(!big.pt() && (big.pts() == 2), "a contiguous segment of megapages got page tables");
+        check(big.phy_address() && !(Reg(big.phy_address()) % MEGAPAGE), "a segment of megapages isn't aligned to megapages");
+
+        // Other contiguous segments are mapped with 4 KB pages, on consecutive frames
+        Segment contiguous(5 * PAGE, Flags::APP | Flags::CT);
+        check(contiguous.pt() && (contiguous.pts() == 1), "a contiguous segment of 4 KB pages got no page table");
+
+        // Non-contiguous segments are mapped with 4 KB pages on any frames
+        Segment scattered(3 * PAGE + 1, Flags::APP);
+        check(scattered.pt() && !scattered.phy_address() && (scattered.size() == 4 * PAGE), "a non-contiguous segment got no page table");
+
+        Reg b = as.attach(&big);
+        Reg c = as.attach(&contiguous);
+        Reg s = as.attach(&scattered);
+        check(b && c && s, "attach() failed");
+        check(!(b % MEGAPAGE) && !(c % MEGAPAGE) && !(s % MEGAPAGE), "attach() returned an address not aligned to megapages");
+        check(mapped(as, b, big.phy_address(), big.size()), "the megapages aren't mapped to the segment's frames");
+        check(mapped(as, c, contiguous.phy_address(), contiguous.size()), "the 4 KB pages aren't mapped to the segment's consecutive frames");
+        check(mapped(as, s, 0, scattered.size()), "the 4 KB pages aren't mapped");
+        check(unmapped(as, s + scattered.size(), PAGE), "a page past the segment is mapped");
+
+        // Address spaces don't share their segments' mappings
+        check(unmapped(other, b, big.size()) && unmapped(other, s, scattered.size()), "a segment is mapped where it wasn't attached");
+
+        // Detached segments are unmapped, but the others stay mapped
+        Reg frame = as.physical(s);
+        as.detach(&big);
+        as.detach(&scattered, s);
+        check(unmapped(as, b, big.size()) && unmapped(as, s, scattered.size()), "detach() left pages mapped");
+        check(mapped(as, c, contiguous.phy_address(), contiguous.size()), "detach() unmapped other segments");
+
+        // Segments can be reattached at given addresses, keeping their frames, but not over others
+        check(as.attach(&scattered, b) == b, "attach() at a free address failed");
+        check(as.physical(b) == frame, "a reattached segment has new frames");
+        check(!as.attach(&big, c), "attach() over another segment succeeded");
+        Reg r = as.attach(&big);
+        check(r && (r != b) && (r != c), "attach() returned an address in use");
+        check(mapped(as, r, big.phy_address(), big.size()), "the reattached megapages aren't mapped to the segment's frames");
+
+        // The same segment can be attached to many address spaces
+        check(other.attach(&big, b) == b, "attach() to another address space failed");
+        check(mapped(other, b, big.phy_address(), big.size()) && mapped(as, r, big.phy_address(), big.size()), "a shared segment isn't mapped to the same frames");
+        other.detach(&big);
+
+        as.detach(&big, r);
+        as.detach(&scattered);
+        as.detach(&contiguous);
+        check(unmapped(as, r, big.size()) && unmapped(as, b, scattered.size()) && unmapped(as, c, contiguous.size()), "detach() left pages mapped");
+    }
+
+    // Address spaces beyond the ASIDs share ASID 0, but work just the same
+    {
+        Address_Space * spaces[ADDRESS_SPACES];
+        Segment segment(PAGE, Flags::APP);
+        for(unsigned int i = 0; i < ADDRESS_SPACES; i++) {
+            spaces[i] = new Address_Space;
+            Reg log = spaces[i]->attach(&segment);
+            check(log && mapped(*spaces[i], log, 0, PAGE), "an address space didn't map its segment");
+        }
+        for(unsigned int i = 0; i < ADDRESS_SPACES; i++) {
+            spaces[i]->detach(&segment);
+            delete spaces[i];
+        }
+    }
+
+    check(MMU::allocable() == allocable, "frames were not given back to the MMU");
+
+    if(!errors)
+        cout << "Passed!" << endl;
+
+    return 0;
+}
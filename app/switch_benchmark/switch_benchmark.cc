@@ -0,0 +1,152 @@
+// EPOS Context Switch Benchmark
+
+// Measures the latency, in TSC ticks, of the paths through Thread::dispatch()
+// and CPU::switch_context(): a ping-pong of two threads yielding to each other,
+// a handoff through a pair of semaphores, the wakeup of a thread by an
+// interrupt handler (of an Alarm) and the jitter of a periodic Alarm. The TSC
+// counts CPU cycles on IA32, while on other architectures it ticks at
+// TSC::frequency(). Select the machine in the traits (e.g. Legacy_PC,
+// Realview_PBX, SiFive_E or SiFive_U) and use "make APPLICATION=switch_benchmark run".
+
+#include <utility/ostream.h>
+#include <architecture/tsc.h>
+#include <process.h>
+#include <synchronizer.h>
+#include <time.h>
+
+using namespace EPOS;
+
+const unsigned int SAMPLES = 1000;
+const unsigned int PERIOD = 10000; // us
+const unsigned int ACTIVATIONS = 100;
+
+typedef TSC::Time_Stamp Time_Stamp;
+
+OStream cout;
+
+// Latency statistics, with percentiles taken from the sorted samples
+struct Latency
+{
+    Latency(): count(0) {}
+
+    void sample(const Time_Stamp & t) {
+        if(count < SAMPLES)
+            samples[count++] = t;
+    }
+
+    Time_Stamp percentile(unsigned int p) const { return samples[(count - 1) * p / 100]; }
+
+    void report(const char * name) {
+        if(!count) {
+            cout << name << ": no samples!" << endl;
+            return;
+        }
+
+        Time_Stamp total = 0;
+        for(unsigned int i = 1; i < count; i++) {
+            Time_Stamp t = samples[i];
+            unsigned int j = i;
+            for(; (j > 0) && (samples[j - 1] > t); j--)
+                samples[j] = samples[j - 1];
+            samples[j] = t;
+        }
+        for(unsigned int i = 0; i < count; i++)
+            total += samples[i];
+
+        cout << name << " (" << count << " samples):" << endl;
+        cout << "  min=" << samples[0] << ", avg=" << total / count << ", max=" << samples[count - 1] << endl;
+        cout << "  p50=" << percentile(50) << ", p90=" << percentile(90) << ", p99=" << percentile(99) << endl;
+    }
+
+    Time_Stamp samples[SAMPLES];
+    unsigned int count;
+};
+
+Latency yield_latency;
+Latency handoff_latency;
+Latency wakeup_latency;
+Latency alarm_jitter;
+
+volatile Time_Stamp stamp;
+
+// Both threads stamp before yielding, so each sample covers a single switch
+int ping_pong()
+{
+    for(unsigned int i = 0; i < SAMPLES / 2; i++) {
+        Time_Stamp t = TSC::time_stamp();
+        if(stamp)
+            yield_latency.sample(t - stamp);
+        stamp = TSC::time_stamp();
+        Thread::yield();
+    }
+
+    return 0;
+}
+
+Semaphore ping(0);
+Semaphore pong(0);
+
+// From v() on one side to the return from p() on the other
+int handoff()
+{
+    for(unsigned int i = 0; i < SAMPLES / 2; i++) {
+        ping.p();
+        handoff_latency.sample(TSC::time_stamp() - stamp);
+        stamp = TSC::time_stamp();
+        pong.v();
+    }
+
+    return 0;
+}
+
+Semaphore interrupted(0);
+volatile Time_Stamp last;
+
+// Runs in interrupt context, on every activation of the Alarm
+void activation()
+{
+    Time_Stamp now = TSC::time_stamp();
+    if(last) {
+        Time_Stamp period = Time_Stamp(PERIOD) * TSC::frequency() / 1000000;
+        Time_Stamp interval = now - last;
+        alarm_jitter.sample(interval > period ? interval - period : period - interval);
+    }
+    last = now;
+    stamp = TSC::time_stamp();
+    interrupted.v();
+}
+
+int main()
+{
+    cout << "Context Switch Benchmark (" << SAMPLES << " samples, " << PERIOD << " us alarm period, latency in TSC ticks at " << TSC::frequency() << " Hz)" << endl;
+
+    stamp = 0;
+    Thread * peer = new Thread(&ping_pong);
+    ping_pong();
+    peer->join();
+    delete peer;
+    yield_latency.report("yield ping-pong");
+
+    peer = new Thread(&handoff);
+    for(unsigned int i = 0; i < SAMPLES / 2; i++) {
+        stamp = TSC::time_stamp();
+        ping.v();
+        pong.p();
+        handoff_latency.sample(TSC::time_stamp() - stamp);
+    }
+    peer->join();
+    delete peer;
+    handoff_latency.report("semaphore handoff");
+
+    last = 0;
+    Function_Handler handler(&activation);
+    Alarm alarm(PERIOD, &handler, ACTIVATIONS);
+    for(unsigned int i = 0; i < ACTIVATIONS; i++) {
+        interrupted.p();
+        wakeup_latency.sample(TSC::time_stamp() - stamp);
+    }
+    wakeup_latency.report("interrupt to thread");
+    alarm_jitter.report("alarm jitter");
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+// EPOS TLB Benchmark
+
+// Sweeps a 16 MB segment, one load per 4 KB page, first mapped with 4 KB
+// pages and then, being contiguous, with 4 MB pages (see
+// Traits<MMU>::large_pages). Data TLB misses that cause page walks, the
+// cycles spent walking and the misses caught by the second-level TLB are
+// counted with the Sandy Bridge PMU events DTLB_LOAD_MISSES_*, so
+// Traits<PMU>::VERSION must be SANDY_BRIDGE.
+
+#include <utility/ostream.h>
+#include <architecture/pmu.h>
+#include <architecture/tsc.h>
+#include <memory.h>
+
+using namespace EPOS;
+
+const unsigned int SEGMENT_SIZE = 16 * 1024 * 1024;
+const unsigned int STRIDE = 4096 + 64; // a different page and cache set on each load
+const unsigned int PASSES = 16;
+
+// Events
+constexpr PMU::Event WALKS = PMU::event(PMU::DTLB_LOAD_MISSES_MISS_CAUSES_A_WALK);
+constexpr PMU::Event WALK_CYCLES = PMU::event(PMU::DTLB_LOAD_MISSES_MISS_WALK_DURATION);
+constexpr PMU::Event STLB_HITS = PMU::event(PMU::DTLB_LOAD_MISSES_MISS_STLB_HIT);
+
+// Channels below PMU::FIXED count fixed events
+const PMU::Channel CHANNELS[] = { PMU::FIXED, PMU::FIXED + 1, PMU::FIXED + 2 };
+const PMU::Event EVENTS[] = { WALKS, WALK_CYCLES, STLB_HITS };
+const unsigned int COUNTERS = sizeof(EVENTS) / sizeof(PMU::Event);
+
+typedef TSC::Time_Stamp Time_Stamp;
+
+volatile unsigned int sink;
+
+OStream cout;
+
+void sweep(const char * name, Segment * seg)
+{
+    Address_Space self(MMU::current());
+    volatile char * base = self.attach(seg);
+    if(!base) {
+        cout << name << ": attach failed!" << endl;
+        return;
+    }
+
+    // Touch every page once, so only the TLB is cold in the measured passes
+    for(unsigned int i = 0; i < SEGMENT_SIZE; i += sizeof(MMU::Page))
+        base[i] = i;
+
+    for(unsigned int i = 0; i < COUNTERS; i++)
+        PMU::write(CHANNELS[i], 0);
+
+    unsigned int sum = 0;
+    unsigned int loads = 0;
+    Time_Stamp t = TSC::time_stamp();
+    for(unsigned int pass = 0; pass < PASSES; pass++)
+        for(unsigned int i = 0; i < SEGMENT_SIZE; i += STRIDE, loads++)
+            sum += base[i];
+    t = TSC::time_stamp() - t;
+
+    PMU::Count counts[COUNTERS];
+    for(unsigned int i = 0; i < COUNTERS; i++)
+        counts[i] = PMU::read(CHANNELS[i]);
+    sink = sum;
+
+    self.detach(seg);
+
+    cout << name << " (segment at " << reinterpret_cast<void *>(const_cast<char *>(base)) << "):" << endl;
+    cout << "  loads: " << loads << ", " << t / loads << " ticks/load" << endl;
+    cout << "  DTLB misses causing walks: " << counts[0] << " (" << counts[0] * 100 / loads << "% of loads)" << endl;
+    cout << "  page walk cycles: " << counts[1] << endl;
+    cout << "  DTLB misses hitting the STLB: " << counts[2] << endl;
+}
+
+int main()
+{
+    cout << "TLB Benchmark (" << SEGMENT_SIZE / 1024 << " KB segment, " << PASSES << " passes, " << (Traits<MMU>::large_pages ? "4 MB pages enabled" : "4 MB pages disabled") << ")" << endl;
+
+    for(unsigned int i = 0; i < COUNTERS; i++)
+        PMU::config(CHANNELS[i], EVENTS[i]);
+
+    {
+        Segment small(SEGMENT_SIZE, Segment::Flags::SYS);
+        sweep("4 KB pages", &small);
+    }
+
+    {
+        Segment large(SEGMENT_SIZE, Segment::Flags::SYS | Segment::Flags::CT);
+        sweep("4 MB pages", &large);
+    }
+
+    return 0;
+}
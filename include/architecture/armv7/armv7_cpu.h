@@ -212,6 +212,14 @@ public:
         return disabled;
     }
 
+    // Execution priority mask: exceptions with priority values at or above it are held pending (0 masks none)
+    static Reg32 basepri() {
+        register Reg32 value;
+        ASM("mrs %0, basepri" : "=r"(value) :);
+        return value;
+    }
+    static void basepri(const Reg32 & value) { ASM("msr basepri, %0" : : "r"(value) : "memory"); }
+
     static void mrs12() { ASM("mrs r12, xpsr" : : : "r12"); }
     static void msr12() { ASM("msr xpsr_nzcvq, r12" : : : "cc"); }
 };
@@ -312,6 +320,8 @@ class CPU: public SWITCH<Traits<Build>::MODEL, CASE<Traits<Build>::eMote3, ARMv7
 private:
     typedef SWITCH<Traits<Build>::MODEL, CASE<Traits<Build>::eMote3, ARMv7_M, CASE<Traits<Build>::LM3S811, ARMv7_M, CASE<DEFAULT, ARMv7_A>>>>::Result Base;
 
+    static const bool smp = Traits<System>::multicore;
+
 public:
     // CPU Native Data Types
     using Base::Reg8;
@@ -373,6 +383,25 @@ public:
         Reg32 _pc;
     };
 
+    // FPU Context (VFP registers), switched lazily (see fpu_trap())
+    class FPU_Context
+    {
+    public:
+        FPU_Context(): _fpscr(0) {
+            for(unsigned int i = 0; i < 16; i++)
+                _d[i] = 0;
+        }
+
+    public:
+        Reg64 _d[16];
+        Reg32 _fpscr;
+    };
+
+    // FPU Exception Register (FPEXC)
+    enum {
+        FPEXC_EN        = 1 << 30       // VFP enable
+    };
+
     // I/O ports
     typedef Reg16 IO_Irq;
 
@@ -425,6 +454,36 @@ public:
                 "       vpop    {s16-s31}               \n");
     }
 
+    static void fpu_enable() {
+        if(Traits<FPU>::enabled)
+            ASM("vmsr fpexc, %0" : : "r"(FPEXC_EN));
+    }
+    static void fpu_disable() {
+        if(Traits<FPU>::enabled)
+            ASM("vmsr fpexc, %0" : : "r"(0));
+    }
+    static bool fpu_enabled() {
+        Reg32 value = 0;
+        if(Traits<FPU>::enabled)
+            ASM("vmrs %0, fpexc" : "=r"(value) : );
+        return value & FPEXC_EN;
+    }
+
+    static void fpu_save(FPU_Context * ctx) {
+        if(Traits<FPU>::enabled)
+            ASM("       vstmia  %1, {d0-d15}            \n"
+                "       vmrs    %0, fpscr               \n" : "=r"(ctx->_fpscr) : "r"(ctx->_d) : "memory");
+    }
+    static void fpu_restore(FPU_Context * ctx) {
+        if(Traits<FPU>::enabled)
+            ASM("       vldmia  %0, {d0-d15}            \n"
+                "       vmsr    fpscr, %1               \n" : : "r"(ctx->_d), "r"(ctx->_fpscr) : "memory");
+    }
+
+    static void fpu_switch(FPU_Context * prev, FPU_Context * next);
+    static bool fpu_trap();
+    static void fpu_release(FPU_Context * ctx);
+
     static void switch_context(Context ** o, Context * n) __attribute__ ((naked));
 
     template<typename ... Tn>
@@ -477,6 +536,8 @@ private:
 private:
     static unsigned int _cpu_clock;
     static unsigned int _bus_clock;
+    static FPU_Context * _fpu_owner[Traits<Build>::CPUS];
+    static FPU_Context * _fpu_running[Traits<Build>::CPUS];
 };
 
 inline CPU::Reg64 htole64(CPU::Reg64 v) { return CPU::htole64(v); }
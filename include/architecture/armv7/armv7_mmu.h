@@ -17,6 +17,9 @@ class MMU: public MMU_Common<0, 0, 0>
     friend class CPU;
 
 private:
+    // Frames are bytes here, so memory is kept in a first-fit list: a buddy
+    // allocator would round every block up to a naturally aligned power of 2,
+    // which small parts (e.g. the 32 KB EPOSMote III) can't afford
     typedef Grouping_List<unsigned int> List;
 
     static const unsigned int PHY_MEM = Memory_Map::PHY_MEM;
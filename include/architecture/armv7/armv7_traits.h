@@ -25,6 +25,7 @@ template<> struct Traits<FPU>: public Traits<Build>
 {
     static const bool enabled = (Traits<Build>::MODEL == Traits<Build>::Raspberry_Pi3);;
     static const bool user_save = true;
+    static const bool lazy = true; // the kernel switches FPU contexts on the first FPU use after a thread switch (FPEXC.EN)
 };
 
 template<> struct Traits<TSC>: public Traits<Build>
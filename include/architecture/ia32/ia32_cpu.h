@@ -96,7 +96,8 @@ public:
 
     // CR4 Flags
     enum {
-        CR4_PSE     = 1 << 8    // CR4 Performance Counter Enable
+        CR4_PSE     = 1 << 4,   // Page Size Extensions  (1->4 MB pages for PDEs with PS set)
+        CR4_PCE     = 1 << 8    // Performance Counter Enable (1->RDPMC at any privilege level)
     };
 
     // Segment Flags
@@ -314,6 +315,22 @@ public:
         Reg32 _eflags;
     };
 
+    // FPU Context (x87 state as stored by FNSAVE), switched lazily (see fpu_trap())
+    class FPU_Context
+    {
+    public:
+        FPU_Context(): _fcw(0x037f), _fsw(0), _ftw(0xffff) { // FNINIT state: all exceptions masked, empty register stack
+            for(unsigned int i = 0; i < sizeof(_state) / sizeof(Reg32); i++)
+                _state[i] = 0;
+        }
+
+    private:
+        Reg32 _fcw;
+        Reg32 _fsw;
+        Reg32 _ftw;
+        Reg32 _state[24]; // instruction and operand pointers and ST0-ST7
+    };
+
     // I/O ports
     typedef Reg16 IO_Port;
     typedef Reg16 IO_Irq;
@@ -374,8 +391,14 @@ public:
 
     static void halt() { ASM("hlt"); }
 
-    static void fpu_save() {} // TODO
-    static void fpu_restore() {} // TODO
+    static void fpu_enable() { ASM("clts"); }
+    static void fpu_disable() { cr0(cr0() | CR0_TS); }
+    static bool fpu_enabled() { return !(cr0() & CR0_TS); }
+    static void fpu_save(FPU_Context * ctx) { ASM("fnsave %0" : "=m"(*ctx)); }
+    static void fpu_restore(FPU_Context * ctx) { ASM("frstor %0" : : "m"(*ctx)); }
+    static void fpu_switch(FPU_Context * prev, FPU_Context * next);
+    static bool fpu_trap();
+    static void fpu_release(FPU_Context * ctx);
     static void switch_context(Context * volatile * o, Context * volatile n);
 
     static void syscall(void * message);
@@ -679,6 +702,8 @@ private:
     static Hertz _cpu_clock;
     static Hertz _cpu_current_clock;
     static Hertz _bus_clock;
+    static FPU_Context * _fpu_owner[Traits<Build>::CPUS];
+    static FPU_Context * _fpu_running[Traits<Build>::CPUS];
 };
 
 inline CPU::Reg64 htole64(CPU::Reg64 v) { return CPU::htole64(v); }
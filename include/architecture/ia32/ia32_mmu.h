@@ -8,6 +8,7 @@
 #include <system/memory_map.h>
 #include <utility/string.h>
 #include <utility/list.h>
+#include <utility/buddy.h>
 #include <utility/debug.h>
 
 __BEGIN_SYS
@@ -23,6 +24,14 @@ private:
     static const unsigned int COLORS = Traits<MMU>::COLORS;
     static const unsigned int PHY_MEM = Memory_Map::PHY_MEM;
 
+    // 4 MB pages are mapped straight by directory entries (PS), without page tables
+    static const bool large_pages = Traits<MMU>::large_pages;
+    static const unsigned int LARGE_PAGE = 1 << DIRECTORY_SHIFT;
+
+    // WHITE frames come from a buddy allocator, whose free lists are linked
+    // through the frames themselves at their logical addresses (phy2log())
+    typedef Buddy_Allocator<Memory_Map::MEM_BASE, Memory_Map::MEM_TOP, sizeof(Frame), PHY_MEM> Buddy;
+
 public:
     // Page Flags
     class IA32_Flags
@@ -127,25 +136,43 @@ public:
     };
 
     // Chunk (for Segment)
+    // Contiguous chunks whose sizes are multiples of 4 MB are mapped with
+    // large pages instead of page tables (the buddy allocator aligns them to
+    // their sizes), thus taking one TLB entry per 4 MB
     class Chunk
     {
     public:
         Chunk() {}
 
         Chunk(unsigned int bytes, const Flags & flags, const Color & color = WHITE)
-        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _pt(calloc(_pts, WHITE)) {
-            if(flags & IA32_Flags::CT)
-                _pt->map_contiguous(_from, _to, _flags, color);
-            else
-                _pt->map(_from, _to, _flags, color);
+        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _phy(false), _pt(0) {
+            if(large(flags & IA32_Flags::CT, 0, bytes) && (color == WHITE))
+                _phy = alloc(_to - _from, color);
+            else {
+                _pt = calloc(_pts, WHITE);
+                if(flags & IA32_Flags::CT)
+                    _pt->map_contiguous(_from, _to, _flags, color);
+                else
+                    _pt->map(_from, _to, _flags, color);
+            }
         }
 
         Chunk(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & flags)
-        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _pt(calloc(_pts, WHITE)) {
-            _pt->remap(phy_addr, _from, _to, flags);
+        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(IA32_Flags(flags)), _phy(false), _pt(0) {
+            if(large(true, phy_addr, bytes))
+                _phy = phy_addr;
+            else {
+                _pt = calloc(_pts, WHITE);
+                _pt->remap(phy_addr, _from, _to, flags);
+            }
         }
 
         ~Chunk() {
+            if(!_pt) {
+                if(!(_flags & IA32_Flags::IO))
+                    free(_phy, _to - _from);
+                return;
+            }
             if(!(_flags & IA32_Flags::IO)) {
                 if(_flags & IA32_Flags::CT)
                     free((*static_cast<Page_Table *>(phy2log(_pt)))[_from], _to - _from);
@@ -162,7 +189,7 @@ public:
         unsigned int size() const { return (_to - _from) * sizeof(Page); }
 
         Phy_Addr phy_address() const {
-            return (_flags & IA32_Flags::CT) ? Phy_Addr(indexes((*_pt)[_from])) : Phy_Addr(false);
+            return (_flags & IA32_Flags::CT) ? (_pt ? Phy_Addr(indexes((*_pt)[_from])) : _phy) : Phy_Addr(false);
         }
 
         int resize(unsigned int amount) {
@@ -189,11 +216,22 @@ public:
             return pgs * sizeof(Page);
         }
 
+        // Directory entry that maps the i-th 4 MB of the chunk
+        PD_Entry entry(unsigned int i) const {
+            return _pt ? (Phy_Addr(_pt + i) | _flags) : ((_phy + i * LARGE_PAGE) | _flags | IA32_Flags::PS);
+        }
+
+    private:
+        static bool large(bool contiguous, const Phy_Addr & phy, unsigned int bytes) {
+            return large_pages && contiguous && bytes && !(phy % LARGE_PAGE) && !(bytes % LARGE_PAGE);
+        }
+
     private:
         unsigned int _from;
         unsigned int _to;
         unsigned int _pts;
         IA32_Flags _flags;
+        Phy_Addr _phy; // large pages only
         Page_Table * _pt;
     };
 
@@ -219,21 +257,21 @@ public:
 
         Log_Addr attach(const Chunk & chunk, unsigned int from = 0) {
             for(unsigned int i = from; i < PD_ENTRIES; i++)
-                if(attach(i, chunk.pt(), chunk.pts(), chunk.flags()))
+                if(attach(i, chunk))
                     return i << DIRECTORY_SHIFT;
             return false;
         }
 
         Log_Addr attach(const Chunk & chunk, const Log_Addr & addr) {
             unsigned int from = directory(addr);
-            if(!attach(from, chunk.pt(), chunk.pts(), chunk.flags()))
+            if(!attach(from, chunk))
                 return Log_Addr(false);
             return from << DIRECTORY_SHIFT;
         }
 
         void detach(const Chunk & chunk) {
             for(unsigned int i = 0; i < PD_ENTRIES; i++)
-                if(indexes((*_pd)[i]) == indexes(chunk.pt())) {
+                if(indexes((*static_cast<Page_Directory *>(phy2log(_pd)))[i]) == indexes(chunk.entry(0))) {
                     detach(i, chunk.pt(), chunk.pts());
                 return;
             }
@@ -242,25 +280,24 @@ public:
 
         void detach(const Chunk & chunk, const Log_Addr & addr) {
             unsigned int from = directory(addr);
-            if(indexes((*static_cast<Log_Addr *>(phy2log(_pd)))[from]) != indexes(chunk.pt())) {
+            if(indexes((*static_cast<Log_Addr *>(phy2log(_pd)))[from]) != indexes(chunk.entry(0))) {
                 db<MMU>(WRN) << "MMU::Directory::detach(pt=" << chunk.pt() << ",addr=" << addr << ") failed!" << endl;
                 return;
             }
             detach(from, chunk.pt(), chunk.pts());
         }
 
-        Phy_Addr physical(const Log_Addr & addr) {
-            Page_Table * pt = reinterpret_cast<Page_Table *>((void *)(*_pd)[directory(addr)]);
-            return (*pt)[page(addr)] | offset(addr);
-        }
+        Phy_Addr physical(const Log_Addr & addr) { return translate(_pd, addr); }
 
     private:
-        bool attach(unsigned int from, const Page_Table * pt, unsigned int n, IA32_Flags flags) {
-            for(unsigned int i = from; i < from + n; i++)
+        bool attach(unsigned int from, const Chunk & chunk) {
+            if(from + chunk.pts() > PD_ENTRIES)
+                return false;
+            for(unsigned int i = from; i < from + chunk.pts(); i++)
                 if((*static_cast<Page_Directory *>(phy2log(_pd)))[i])
                     return false;
-            for(unsigned int i = from; i < from + n; i++, pt++)
-                (*static_cast<Page_Directory *>(phy2log(_pd)))[i] = Phy_Addr(pt) | flags;
+            for(unsigned int i = from; i < from + chunk.pts(); i++)
+                (*static_cast<Page_Directory *>(phy2log(_pd)))[i] = chunk.entry(i - from);
             return true;
         }
 
@@ -312,11 +349,17 @@ public:
         Phy_Addr phy(false);
 
         if(frames) {
-            List::Element * e = _free[color].search_decrementing(frames);
-            if(e) {
-                phy = e->object() + e->size();
+            if(color == WHITE)
+                phy = _buddy.alloc(frames * sizeof(Frame));
+            else {
+                List::Element * e = _free[color].search_decrementing(frames);
+                if(e)
+                    phy = e->object() + e->size();
+            }
+
+            if(phy)
                 db<MMU>(TRC) << "MMU::alloc(frames=" << frames << ",color=" << color << ") => " << phy << endl;
-            } else
+            else
                 if(colorful)
                     db<MMU>(INF) << "MMU::alloc(frames=" << frames << ",color=" << color << ") => failed!" << endl;
                 else
@@ -342,36 +385,39 @@ public:
         db<MMU>(TRC) << "MMU::free(frame=" << frame << ",color=" << color << ",n=" << n << ")" << endl;
 
         if(frame && n) {
-            List::Element * e = new (phy2log(frame)) List::Element(frame, n);
-            List::Element * m1, * m2;
-            _free[color].insert_merging(e, &m1, &m2);
+            if(color == WHITE)
+                _buddy.free(frame, n * sizeof(Frame));
+            else {
+                List::Element * e = new (phy2log(frame)) List::Element(frame, n);
+                List::Element * m1, * m2;
+                _free[color].insert_merging(e, &m1, &m2);
+            }
         }
     }
 
+    // Frames handed to the MMU at initialization (not necessarily allocated before)
     static void white_free(Phy_Addr frame, int n) {
         // Clean up MMU flags in frame address
         frame = indexes(frame);
 
         db<MMU>(TRC) << "MMU::free(frame=" << frame << ",color=" << WHITE << ",n=" << n << ")" << endl;
 
-        if(frame && n) {
-            List::Element * e = new (phy2log(frame)) List::Element(frame, n);
-            List::Element * m1, * m2;
-            _free[WHITE].insert_merging(e, &m1, &m2);
-        }
+        if(frame && n)
+            _buddy.add(frame, n * sizeof(Frame));
     }
 
-    static unsigned int allocable(const Color & color = WHITE) { return _free[color].head() ? _free[color].head()->size() : 0; }
+    static unsigned int allocable(const Color & color = WHITE) {
+        if(color == WHITE)
+            return _buddy.largest() / sizeof(Frame);
+        else
+            return _free[color].head() ? _free[color].head()->size() : 0;
+    }
 
     static Page_Directory * volatile current() {
         return reinterpret_cast<Page_Directory * volatile>(CPU::pdp());
     }
 
-    static Phy_Addr physical(const Log_Addr & addr) {
-        Page_Directory * pd = current();
-        Page_Table * pt = (*pd)[directory(addr)];
-        return (*pt)[page(addr)] | offset(addr);
-    }
+    static Phy_Addr physical(const Log_Addr & addr) { return translate(current(), addr); }
 
     static void flush_tlb() {
         ASM("movl %cr3,%eax");
@@ -388,18 +434,20 @@ private:
 
     static Color phy2color(const Phy_Addr & phy) { return static_cast<Color>(colorful ? ((phy >> PAGE_SHIFT) & 0x7f) % COLORS : WHITE); } // TODO: what is 0x7f
 
-    static Color log2color(const Log_Addr & log) {
-        if(colorful) {
-            Page_Directory * pd = current();
-            Page_Table * pt = (*pd)[directory(log)];
-            Phy_Addr phy = (*pt)[page(log)] | offset(log);
-            return static_cast<Color>(((phy >> PAGE_SHIFT) & 0x7f) % COLORS);
-        } else
-            return WHITE;
+    static Color log2color(const Log_Addr & log) { return colorful ? phy2color(translate(current(), log)) : WHITE; }
+
+    // Walks pd down to the page, or the large page, that maps addr
+    static Phy_Addr translate(Page_Directory * pd, const Log_Addr & addr) {
+        PD_Entry pde = (*static_cast<Page_Directory *>(phy2log(pd)))[directory(addr)];
+        if(pde & IA32_Flags::PS)
+            return (pde & ~(LARGE_PAGE - 1)) | (addr & (LARGE_PAGE - 1));
+        Page_Table * pt = reinterpret_cast<Page_Table *>(indexes(pde));
+        return indexes((*static_cast<Page_Table *>(phy2log(pt)))[page(addr)]) | offset(addr);
     }
 
 private:
     static List _free[colorful * COLORS + 1]; // +1 for WHITE
+    static Buddy _buddy;
     static Page_Directory * _master;
 };
 
@@ -689,6 +689,13 @@ public:
         else
             db<Init, Intel_PMU_V1>(WRN) << "Intel_PMU_V1::handler = Bad PMC value, handler not addressed!" << endl;
     }
+
+    // Number of a named event (e.g. DTLB_LOAD_MISSES_MISS_STLB_HIT) as taken
+    // by config(), or EVENTS if it isn't listed in _events
+    static constexpr Event event(Event code, Event num = 0) {
+        return ((num == EVENTS) || (_events[num] == code)) ? num : event(code, num + 1);
+    }
+
 private:
     static constexpr Event _events[EVENTS] = {
         // Architecture                              // NUM
@@ -23,12 +23,14 @@ template<> struct Traits<MMU>: public Traits<Build>
 {
     static const bool colorful = false;
     static const unsigned int COLORS = 1;
+    static const bool large_pages = true; // 4 MB pages (PSE) for physical memory and for contiguous chunks of multiples of 4 MB
 };
 
 template<> struct Traits<FPU>: public Traits<Build>
 {
     static const bool enabled = true;
     static const bool user_save = true;
+    static const bool lazy = true; // the kernel switches FPU contexts on the first FPU use after a thread switch (CR0.TS/#NM)
 };
 
 template<> struct Traits<PMU>: public Traits<Build>
@@ -35,6 +35,9 @@ public:
         MPP             = 3 << 11,     // Machine Previous Privilege
         SPP             = 3 << 12,     // Supervisor Previous Privilege
         MPRV            = 1 << 17,     // Memory Priviledge
+        FS              = 3 << 13,     // Floating-point Status (Off, Initial, Clean or Dirty)
+        FS_CLEAN        = 2 << 13,     // FPU on, registers unchanged since loaded
+        FS_DIRTY        = 3 << 13,     // FPU on, registers changed since loaded
         TVM             = 1 << 20,     // Trap Virtual Memory //not allow MMU
         MSTATUS_DEFAULTS= (MIE | MPIE | MPP)
     };
@@ -154,6 +157,20 @@ public:
         Reg32 _x31; // t6
     };
 
+    // FPU Context (F and D extensions), switched lazily (see fpu_trap())
+    class FPU_Context
+    {
+    public:
+        FPU_Context(): _fcsr(0) {
+            for(unsigned int i = 0; i < 32; i++)
+                _f[i] = 0;
+        }
+
+    public:
+        Reg64 _f[32];
+        Reg32 _fcsr;
+    };
+
     // Interrupt Service Routines
     typedef void (ISR)();
 
@@ -189,8 +206,15 @@ public:
         return value;
     }
 
-    static Reg32 pdp() { return 0; }
-    static void pdp(const Reg32 & pdp) {}
+    // Supervisor address translation and protection (i.e. satp), which sets the page directory
+    static Reg pdp() {
+        Reg value;
+        ASM("csrr %0, satp" : "=r"(value) :);
+        return value;
+    }
+    static void pdp(const Reg & pdp) {
+        ASM("csrw satp, %0" : : "r"(pdp) : "memory");
+    }
 
 
     // Atomic operations
@@ -293,8 +317,15 @@ public:
 
     static unsigned int int_id() { return 0; }
 
-    static void fpu_save();
-    static void fpu_restore();
+    static void fpu_enable(bool dirty = false) { fpu_disable(); ASM("csrs mstatus, %0" : : "r"(dirty ? FS_DIRTY : FS_CLEAN) : "cc"); }
+    static void fpu_disable() { ASM("csrc mstatus, %0" : : "r"(FS) : "cc"); }
+    static bool fpu_enabled() { Reg value; ASM("csrr %0, mstatus" : "=r"(value) : : ); return value & FS; }
+    static bool fpu_dirty() { Reg value; ASM("csrr %0, mstatus" : "=r"(value) : : ); return (value & FS) == FS_DIRTY; }
+    static void fpu_save(FPU_Context * ctx);
+    static void fpu_restore(FPU_Context * ctx);
+    static void fpu_switch(FPU_Context * prev, FPU_Context * next);
+    static bool fpu_trap();
+    static void fpu_release(FPU_Context * ctx);
     static void switch_context(Context ** o, Context * n) __attribute__ ((naked));
 
     template<typename ... Tn>
@@ -347,6 +378,9 @@ private:
 private:
     static unsigned int _cpu_clock;
     static unsigned int _bus_clock;
+    static FPU_Context * _fpu_owner[Traits<Build>::CPUS];
+    static FPU_Context * _fpu_running[Traits<Build>::CPUS];
+    static bool _fpu_dirty[Traits<Build>::CPUS];
 };
 
 inline CPU::Reg64 htole64(CPU::Reg64 v) { return CPU::htole64(v); }
@@ -6,17 +6,22 @@
 #include <system/memory_map.h>
 #include <utility/string.h>
 #include <utility/list.h>
+#include <utility/buddy.h>
 #include <utility/debug.h>
 #include <architecture/cpu.h>
 #include <architecture/mmu.h>
 
 __BEGIN_SYS
 
-class MMU: public MMU_Common<0, 0, 0>
+// Flat memory (LIBRARY mode): everything runs in machine mode on physical addresses
+class No_MMU: public MMU_Common<0, 0, 0>
 {
     friend class CPU;
 
 private:
+    // Frames are bytes here, so memory is kept in a first-fit list: a buddy
+    // allocator would round every block up to a naturally aligned power of 2,
+    // which small memories can't afford
     typedef Grouping_List<unsigned int> List;
 
     static const unsigned int PHY_MEM = Memory_Map::PHY_MEM;
@@ -93,7 +98,7 @@ public:
     };
 
 public:
-    MMU() {}
+    No_MMU() {}
 
     static Phy_Addr alloc(unsigned int bytes = 1) {
         Phy_Addr phy(false);
@@ -147,6 +152,440 @@ private:
     static List _free;
 };
 
+
+// Sv32 MMU (KERNEL mode)
+// Two-level page tables for 32-bit virtual addresses, just like IA32's: the
+// page directory maps 4 MB megapages or points to page tables of 4 KB pages.
+// Chunks are arrays of page tables that directories hook into consecutive
+// entries, while contiguous chunks whose sizes are multiples of 4 MB are
+// mapped with megapages instead, which need no page tables at all (the buddy
+// allocator aligns them to their sizes). Physical memory and I/O are identity
+// mapped by the master directory with megapages, as global supervisor pages
+// shared by all directories. The kernel runs in machine mode, thus on
+// physical addresses, while tasks run in user mode on the directory in satp,
+// which is tagged with an address space identifier (ASID), so switching tasks
+// does not flush the TLB. Once the ASIDs implemented run out, directories
+// share ASID 0, whose activation flushes the TLB.
+class Sv32_MMU: public MMU_Common<10, 10, 12>
+{
+    friend class CPU;
+
+private:
+    typedef CPU::Reg Reg;
+    typedef Buddy_Allocator<Memory_Map::MEM_BASE, Memory_Map::MEM_TOP, sizeof(Frame)> Buddy;
+
+    static const unsigned long MEGAPAGE = 1UL << DIRECTORY_SHIFT;
+
+    // Page table entries
+    static const unsigned int PPN_SHIFT = 10;
+
+    // satp
+    static const Reg SATP_MODE = 1UL << 31;
+    static const unsigned int ASID_SHIFT = 22;
+    static const Reg ASID_MASK = 0x1ff;
+    static const Reg PPN_MASK = (1UL << ASID_SHIFT) - 1;
+
+    static const unsigned int ASIDS = Traits<MMU>::ASIDS;
+    static const unsigned int BPW = sizeof(unsigned long) * 8;
+
+public:
+    // Page Flags
+    // Cacheability is defined by physical memory attributes, hence CD and CWT are ignored
+    class Sv32_Flags
+    {
+    public:
+        enum {
+            V    = 1 << 0, // Valid (0=invalid, 1=valid)
+            R    = 1 << 1, // Readable
+            W    = 1 << 2, // Writable
+            X    = 1 << 3, // Executable
+            U    = 1 << 4, // User (0=supervisor, 1=user)
+            G    = 1 << 5, // Global (mapped in all address spaces)
+            A    = 1 << 6, // Accessed
+            D    = 1 << 7, // Dirty
+            CT   = 1 << 8, // RSW (0=non-contiguous, 1=contiguous)
+            IO   = 1 << 9, // RSW (0=memory, 1=I/O)
+            PTR  = V,      // Pointer to a page table (i.e. neither R, W nor X)
+            SYS  = (V | R | W | X | A | D),
+            APP  = (SYS | U),
+            PIO  = (V | R | W | A | D | IO),
+            MASK = (1 << PPN_SHIFT) - 1
+        };
+
+    public:
+        Sv32_Flags() {}
+        Sv32_Flags(const Sv32_Flags & f) : _flags(f._flags) {}
+        Sv32_Flags(unsigned int f) : _flags(f) {}
+        Sv32_Flags(const Flags & f) : _flags(V | R | A | D |
+                                             ((f & Flags::RW)  ? W  : 0) |
+                                             ((f & Flags::USR) ? U  : 0) |
+                                             ((f & Flags::CT)  ? CT : 0) |
+                                             ((f & Flags::IO)  ? IO : X) ) {}
+
+        operator unsigned int() const { return _flags; }
+
+        friend Debug & operator<<(Debug & db, const Sv32_Flags & f) { db << hex << f._flags << dec; return db; }
+
+    private:
+        unsigned int _flags;
+    };
+
+    // Page_Table
+    class Page_Table
+    {
+    public:
+        Page_Table() {}
+
+        PT_Entry & operator[](unsigned int i) { return _entry[i]; }
+
+        void map(int from, int to, const Sv32_Flags & flags) {
+            Phy_Addr addr = alloc(to - from);
+            if(addr)
+                remap(addr, from, to, flags);
+            else
+                for( ; from < to; from++)
+                    _entry[from] = pte(alloc(1), flags);
+        }
+
+        void map_contiguous(int from, int to, const Sv32_Flags & flags) {
+            remap(alloc(to - from), from, to, flags);
+        }
+
+        void remap(Phy_Addr addr, int from, int to, const Sv32_Flags & flags) {
+            addr = align_page(addr);
+            for( ; from < to; from++) {
+                _entry[from] = pte(addr, flags);
+                addr += sizeof(Page);
+            }
+        }
+
+        void unmap(int from, int to) {
+            for( ; from < to; from++) {
+                free(pte2phy(_entry[from]));
+                _entry[from] = 0;
+            }
+        }
+
+        friend Debug & operator<<(Debug & db, Page_Table & pt) {
+            db << "{\n";
+            int brk = 0;
+            for(unsigned int i = 0; i < PT_ENTRIES; i++)
+                if(pt[i]) {
+                    db << "[" << i << "]=" << pt[i] << "  ";
+                    if(!(++brk % 4))
+                        db << "\n";
+                }
+            db << "\n}";
+            return db;
+        }
+
+    private:
+        PT_Entry _entry[PT_ENTRIES];
+    };
+
+    // Chunk (for Segment)
+    class Chunk
+    {
+    public:
+        Chunk() {}
+
+        Chunk(unsigned int bytes, const Flags & flags)
+        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(Sv32_Flags(flags)), _phy(false), _pt(0) {
+            if((_flags & Sv32_Flags::CT) && !(bytes % MEGAPAGE))
+                _phy = alloc(_to - _from);
+            else {
+                _pt = calloc(_pts);
+                if(_flags & Sv32_Flags::CT)
+                    _pt->map_contiguous(_from, _to, _flags);
+                else
+                    _pt->map(_from, _to, _flags);
+            }
+        }
+
+        Chunk(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & flags)
+        : _from(0), _to(pages(bytes)), _pts(page_tables(_to - _from)), _flags(Sv32_Flags(flags)), _phy(false), _pt(0) {
+            if(!(phy_addr % MEGAPAGE) && !(bytes % MEGAPAGE))
+                _phy = phy_addr;
+            else {
+                _pt = calloc(_pts);
+                _pt->remap(phy_addr, _from, _to, _flags);
+            }
+        }
+
+        ~Chunk() {
+            if(!(_flags & Sv32_Flags::IO)) {
+                if(!_pt)
+                    free(_phy, _to - _from);
+                else if(_flags & Sv32_Flags::CT)
+                    free(pte2phy((*_pt)[_from]), _to - _from);
+                else
+                    for( ; _from < _to; _from++)
+                        free(pte2phy((*_pt)[_from]));
+            }
+            if(_pt)
+                free(_pt, _pts);
+        }
+
+        unsigned int pts() const { return _pts; }
+        Sv32_Flags flags() const { return _flags; }
+        Page_Table * pt() const { return _pt; }
+        unsigned int size() const { return (_to - _from) * sizeof(Page); }
+
+        Phy_Addr phy_address() const {
+            return (_flags & Sv32_Flags::CT) ? (_pt ? pte2phy((*_pt)[_from]) : _phy) : Phy_Addr(false);
+        }
+
+        int resize(unsigned int amount) {
+            if(_flags & Sv32_Flags::CT)
+                return 0;
+
+            unsigned int pgs = pages(amount);
+
+            unsigned int free_pgs = _pts * PT_ENTRIES - _to;
+            if(free_pgs < pgs) { // resize _pt
+                unsigned int pts = _pts + page_tables(pgs - free_pgs);
+                Page_Table * pt = calloc(pts);
+                memcpy(pt, _pt, _pts * sizeof(Page));
+                free(_pt, _pts);
+                _pt = pt;
+                _pts = pts;
+            }
+
+            _pt->map(_to, _to + pgs, _flags);
+            _to += pgs;
+
+            return pgs * sizeof(Page);
+        }
+
+        // Directory entry that maps the i-th 4 MB of the chunk
+        PD_Entry entry(unsigned int i) const {
+            return _pt ? pte(Phy_Addr(_pt) + i * sizeof(Page_Table), Sv32_Flags::PTR) : pte(_phy + i * MEGAPAGE, _flags);
+        }
+
+    private:
+        unsigned int _from;
+        unsigned int _to;
+        unsigned int _pts;
+        Sv32_Flags _flags;
+        Phy_Addr _phy; // megapages only
+        Page_Table * _pt;
+    };
+
+    // Page Directory
+    typedef Page_Table Page_Directory;
+
+    // Directory (for Address_Space)
+    class Directory
+    {
+    public:
+        Directory() : _pd(calloc(1)), _free(true), _asid(alloc_asid()) {
+            for(unsigned int i = 0; i < PD_ENTRIES; i++)
+                (*_pd)[i] = (*_master)[i];
+        }
+
+        Directory(Page_Directory * pd) : _pd(pd), _free(false), _asid((pd == current()) ? (CPU::pdp() >> ASID_SHIFT) & ASID_MASK : 0) {}
+
+        ~Directory() {
+            if(_free) {
+                free(_pd);
+                free_asid(_asid);
+            }
+        }
+
+        Phy_Addr pd() const { return _pd; }
+
+        void activate() const {
+            CPU::pdp(satp(_pd, _asid));
+            if(!_asid)
+                flush_tlb();
+        }
+
+        Log_Addr attach(const Chunk & chunk, unsigned int from = 0) {
+            for(unsigned int i = from; i + chunk.pts() <= PD_ENTRIES; i++)
+                if(attach(i, chunk))
+                    return i << DIRECTORY_SHIFT;
+            return false;
+        }
+
+        Log_Addr attach(const Chunk & chunk, const Log_Addr & addr) {
+            unsigned int from = directory(addr);
+            if((from + chunk.pts() > PD_ENTRIES) || !attach(from, chunk))
+                return Log_Addr(false);
+            return from << DIRECTORY_SHIFT;
+        }
+
+        void detach(const Chunk & chunk) {
+            for(unsigned int i = 0; i < PD_ENTRIES; i++)
+                if((*_pd)[i] == chunk.entry(0)) {
+                    detach(i, chunk.pts());
+                    return;
+                }
+            db<MMU>(WRN) << "MMU::Directory::detach(pt=" << chunk.pt() << ") failed!" << endl;
+        }
+
+        void detach(const Chunk & chunk, const Log_Addr & addr) {
+            unsigned int from = directory(addr);
+            if((*_pd)[from] != chunk.entry(0)) {
+                db<MMU>(WRN) << "MMU::Directory::detach(pt=" << chunk.pt() << ",addr=" << addr << ") failed!" << endl;
+                return;
+            }
+            detach(from, chunk.pts());
+        }
+
+        Phy_Addr physical(const Log_Addr & addr) { return translate(_pd, addr); }
+
+    private:
+        bool attach(unsigned int from, const Chunk & chunk) {
+            for(unsigned int i = from; i < from + chunk.pts(); i++)
+                if((*_pd)[i] & Sv32_Flags::V)
+                    return false;
+            for(unsigned int i = from; i < from + chunk.pts(); i++)
+                (*_pd)[i] = chunk.entry(i - from);
+            flush_asid(_asid);
+            return true;
+        }
+
+        void detach(unsigned int from, unsigned int n) {
+            for(unsigned int i = from; i < from + n; i++)
+                (*_pd)[i] = 0;
+            flush_asid(_asid);
+        }
+
+    private:
+        Page_Directory * _pd;
+        bool _free;
+        unsigned int _asid;
+    };
+
+    // DMA_Buffer (physical memory is identity mapped)
+    class DMA_Buffer: public Chunk
+    {
+    public:
+        DMA_Buffer(unsigned int s) : Chunk(s, Flags::SYS | Flags::CT) {
+            db<MMU>(TRC) << "MMU::DMA_Buffer() => " << *this << endl;
+        }
+
+        Log_Addr log_address() const { return phy2log(phy_address()); }
+
+        friend Debug & operator<<(Debug & db, const DMA_Buffer & b) {
+            db << "{phy=" << b.phy_address()
+               << ",log=" << b.log_address()
+               << ",size=" << b.size()
+               << ",flags=" << b.flags() << "}";
+            return db;
+        }
+    };
+
+public:
+    Sv32_MMU() {}
+
+    static Phy_Addr alloc(unsigned int frames = 1) {
+        Phy_Addr phy(false);
+
+        if(frames) {
+            phy = _buddy.alloc(frames * sizeof(Frame));
+            if(phy)
+                db<MMU>(TRC) << "MMU::alloc(frames=" << frames << ") => " << phy << endl;
+            else
+                db<MMU>(WRN) << "MMU::alloc(frames=" << frames << ") => failed!" << endl;
+        }
+
+        return phy;
+    }
+
+    static Phy_Addr calloc(unsigned int frames = 1) {
+        Phy_Addr phy = alloc(frames);
+        if(phy)
+            memset(phy2log(phy), 0, sizeof(Frame) * frames);
+        return phy;
+    }
+
+    static void free(Phy_Addr frame, unsigned int n = 1) {
+        db<MMU>(TRC) << "MMU::free(frame=" << frame << ",n=" << n << ")" << endl;
+
+        if(frame && n)
+            _buddy.free(frame, n * sizeof(Frame));
+    }
+
+    static unsigned int allocable() { return _buddy.largest() / sizeof(Frame); }
+
+    static Page_Directory * volatile current() {
+        return reinterpret_cast<Page_Directory * volatile>((CPU::pdp() & PPN_MASK) << PAGE_SHIFT);
+    }
+
+    static Phy_Addr physical(const Log_Addr & addr) { return translate(current(), addr); }
+
+    static void flush_tlb() { ASM("sfence.vma" : : : "memory"); }
+    static void flush_tlb(const Log_Addr & addr) { ASM("sfence.vma %0" : : "r"(Reg(addr)) : "memory"); }
+
+private:
+    static void init();
+    static void identity(Phy_Addr from, Phy_Addr to, const Sv32_Flags & flags);
+
+    // Physical memory is identity mapped
+    static Log_Addr phy2log(const Phy_Addr & phy) { return phy; }
+
+    static PT_Entry pte(const Phy_Addr & phy, unsigned int flags) { return ((phy >> PAGE_SHIFT) << PPN_SHIFT) | flags; }
+    static Phy_Addr pte2phy(const PT_Entry & pte) { return (pte >> PPN_SHIFT) << PAGE_SHIFT; }
+    static bool leaf(const PT_Entry & pte) { return pte & (Sv32_Flags::R | Sv32_Flags::W | Sv32_Flags::X); }
+    static Page_Table * table(const PT_Entry & pte) { return phy2log(pte2phy(pte)); }
+
+    static Reg satp(const Phy_Addr & pd, unsigned int asid) { return SATP_MODE | (Reg(asid) << ASID_SHIFT) | (pd >> PAGE_SHIFT); }
+
+    // Walks the tables from pd down to the leaf that maps addr (none while paging is off)
+    static Phy_Addr translate(Page_Directory * pd, const Log_Addr & addr) {
+        if(!pd)
+            return addr;
+
+        PD_Entry e = (*pd)[directory(addr)];
+        if((e & Sv32_Flags::V) && leaf(e))
+            return pte2phy(e) | (addr & (MEGAPAGE - 1));
+        if(!(e & Sv32_Flags::V))
+            return Phy_Addr(false);
+
+        e = (*table(e))[page(addr)];
+        if(!(e & Sv32_Flags::V) || !leaf(e))
+            return Phy_Addr(false);
+
+        return pte2phy(e) | offset(addr);
+    }
+
+    // ASID 0 belongs to the master and to directories that found no free ASID
+    static unsigned int alloc_asid() {
+        for(unsigned int i = 1; i < _asids; i++)
+            if(!(_asid_map[i / BPW] & (1UL << (i % BPW)))) {
+                _asid_map[i / BPW] |= 1UL << (i % BPW);
+                return i;
+            }
+        db<MMU>(INF) << "MMU::alloc_asid() => out of ASIDs!" << endl;
+        return 0;
+    }
+
+    // The TLB might still hold translations of the released ASID
+    static void free_asid(unsigned int asid) {
+        flush_asid(asid);
+        if(asid)
+            _asid_map[asid / BPW] &= ~(1UL << (asid % BPW));
+    }
+
+    static void flush_asid(unsigned int asid) {
+        if(asid)
+            ASM("sfence.vma zero, %0" : : "r"(Reg(asid)) : "memory");
+        else
+            flush_tlb();
+    }
+
+private:
+    static Buddy _buddy;
+    static Page_Directory * _master;
+    static unsigned int _asids; // implemented by the hardware, up to ASIDS
+    static unsigned long _asid_map[(ASIDS + BPW - 1) / BPW];
+};
+
+
+// Paging only pays off for multiple tasks (i.e. KERNEL mode)
+class MMU: public IF<Traits<System>::multitask, Sv32_MMU, No_MMU>::Result {};
+
 __END_SYS
 
 #endif
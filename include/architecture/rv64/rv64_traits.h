@@ -19,12 +19,14 @@ template<> struct Traits<MMU>: public Traits<Build>
 {
     static const bool colorful = false;
     static const unsigned int COLORS = 1;
+    static const unsigned int ASIDS = 64; // address space identifiers used for paging (KERNEL mode), if implemented
 };
 
 template<> struct Traits<FPU>: public Traits<Build>
 {
     static const bool enabled = false;
     static const bool user_save = true;
+    static const bool lazy = true; // the kernel switches FPU contexts on the first FPU use after a thread switch (mstatus.FS)
 };
 
 template<> struct Traits<TSC>: public Traits<Build>
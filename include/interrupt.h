@@ -0,0 +1,96 @@
+// EPOS Deferred Interrupt Handling Declarations
+
+#ifndef __interrupt_h
+#define __interrupt_h
+
+#include <architecture.h>
+#include <utility/list.h>
+#include <utility/spin.h>
+#include <utility/handler.h>
+#include <process.h>
+
+__BEGIN_SYS
+
+// Softirqs (aka bottom halves) carry the work of interrupt handlers out of
+// their ISRs. A softirq raised by a handler is queued on the current CPU and
+// runs, with interrupts enabled, as soon as the interrupt returns (see
+// IC::dispatch()). Raising a pending softirq again has no effect. Softirqs
+// run to completion in the order they were raised and must not block; work
+// that does belongs to an Interrupt_Thread. Those raised outside interrupt
+// handlers wait for the next interrupt on the CPU.
+class Softirq
+{
+    friend class IC;    // for drain()
+
+private:
+    static const bool smp = Traits<Thread>::smp;
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+
+    typedef List<Softirq> Queue;
+
+public:
+    Softirq(Handler * h): _handler(h), _pending(false), _cpu(0), _link(this) {}
+    ~Softirq();
+
+    void raise();
+
+    bool pending() const { return _pending; }
+
+private:
+    static void drain();
+
+    static bool lock() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        if(smp)
+            _lock.acquire();
+        return disabled;
+    }
+    static void unlock(bool disabled) {
+        if(smp)
+            _lock.release();
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+private:
+    Handler * _handler;
+    volatile bool _pending;
+    unsigned int _cpu;
+    Queue::Element _link;
+
+    static Queue _queue[CPUS];
+    static Simple_Spin _lock;
+};
+
+
+// Interrupt service threads run the work of interrupt handlers as ordinary
+// threads, which are scheduled by priority (HIGH by default), can block and
+// are preempted by interrupts. The object is itself the Handler to be called
+// in interrupt context (e.g. by an Alarm or an ISR): each call releases the
+// thread for one more run of the given handler. Like Alarm::wakeup(), it
+// works with the lock already held and doesn't release it.
+class Interrupt_Thread: public Handler
+{
+public:
+    Interrupt_Thread(Handler * handler, const Thread::Criterion & priority = Thread::HIGH);
+    ~Interrupt_Thread();
+
+    void operator()();
+
+    Thread * thread() { return _thread; }
+
+private:
+    static int run(Interrupt_Thread * it);
+
+private:
+    Handler * _handler;
+    volatile unsigned int _runs;
+    volatile bool _finishing;
+    Thread::Queue _queue;
+    Thread * _thread;
+};
+
+__END_SYS
+
+#endif
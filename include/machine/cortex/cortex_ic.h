@@ -5,6 +5,7 @@
 
 #include <architecture/cpu.h>
 #include <machine/ic.h>
+#include <utility/histogram.h>
 #include __HEADER_MMOD(ic)
 
 __BEGIN_SYS
@@ -18,11 +19,30 @@ private:
     typedef CPU::Reg32 Reg32;
 
     static const unsigned int INTS = Engine::INTS;
+    static const bool histogram = Traits<IC>::histogram;
 
 public:
     using Engine::Interrupt_Id;
     using Engine::Interrupt_Handler;
 
+    // Interrupt Priorities
+    // Level 0 is the highest. With Traits<IC>::nested, the handler of an
+    // interrupt is only preempted by interrupts of higher priority, since
+    // dispatch() masks its level (and the lower ones) while it runs.
+    typedef unsigned int Priority;
+    static const unsigned int PRIORITIES = Engine::PRIORITIES;
+    static const bool nested = Traits<IC>::nested && (PRIORITIES > 1);
+    enum {
+        PRIORITY_HIGH   = 0,
+        PRIORITY_NORMAL = PRIORITIES / 2,
+        PRIORITY_LOW    = PRIORITIES - 1,
+        UNMASKED        = PRIORITIES
+    };
+
+    // Response latency of each interrupt, from dispatch() to the return of
+    // its handler (including the handlers that preempted it), in TSC ticks
+    typedef Log2_Histogram<24> Latency;
+
     using Engine::INT_SYS_TIMER;
     using Engine::INT_USER_TIMER0;
     using Engine::INT_USER_TIMER1;
@@ -74,6 +94,28 @@ public:
         Engine::disable(i);
     }
 
+    static Priority priority(Interrupt_Id i) {
+        assert(i < INTS);
+        return Engine::priority(i);
+    }
+    static void priority(Interrupt_Id i, const Priority & p) {
+        db<IC>(TRC) << "IC::priority(int=" << i << ",p=" << p << ")" << endl;
+        assert((i < INTS) && (p < PRIORITIES));
+        Engine::priority(i, p);
+    }
+
+    // Interrupts of priority p or lower are held pending while masked at p
+    static Priority mask() { return nested ? Engine::mask() : Priority(UNMASKED); }
+    static void mask(const Priority & p) {
+        if(nested)
+            Engine::mask(p);
+    }
+
+    static const Latency & latency(Interrupt_Id i) {
+        assert(i < INTS);
+        return _latency[i];
+    }
+
     using Engine::int_id;
     using Engine::irq2int;
     using Engine::int2irq;
@@ -92,12 +134,15 @@ public:
     void fiq();
 
 private:
-    static void dispatch(unsigned int i);
+    // On Cortex-M, IC::entry() masks the interrupt's priority level before
+    // leaving Handler mode and passes the previous mask on to dispatch()
+    static void dispatch(unsigned int i, unsigned int mask);
     static void eoi(unsigned int i);
 
     // Logical handlers
     static void int_not(Interrupt_Id i);
     static void hard_fault(Interrupt_Id i);
+    static void undefined();
 
     // Physical handler
     static void entry();
@@ -107,6 +152,7 @@ private:
 private:
     static Interrupt_Handler _int_vector[INTS];
     static Interrupt_Handler _eoi_vector[INTS];
+    static Latency _latency[histogram ? INTS : 1];
 };
 
 __END_SYS
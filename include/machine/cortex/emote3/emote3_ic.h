@@ -49,6 +49,12 @@ public:
     static Interrupt_Id irq2int(Interrupt_Id id) { return nvic()->irq2int(id); }
     static Interrupt_Id int2irq(Interrupt_Id irq) { return nvic()->int2irq(irq); }
 
+    static const unsigned int PRIORITIES = NVIC::PRIORITIES;
+    static void priority(Interrupt_Id id, unsigned int p) { nvic()->priority(id, p); }
+    static unsigned int priority(Interrupt_Id id) { return nvic()->priority(id); }
+    static void mask(unsigned int p) { NVIC::mask(p); }
+    static unsigned int mask() { return NVIC::mask(); }
+
     static void ipi(unsigned int cpu, Interrupt_Id id) {} // NVIC is always single-core
 
     static void init() { nvic()->init(); };
@@ -13,10 +13,19 @@ __BEGIN_SYS
 class GIC: public IC_Common
 {
 protected:
+    typedef CPU::Reg8 Reg8;
     typedef CPU::Reg32 Reg32;
 
     static const unsigned int INT_ID_MASK = 0x3ff;
 
+public:
+    // Priorities
+    // Only the upper PRIORITY_BITS of each priority byte are implemented (at
+    // least 4). The lowest hardware priority (0xf0) is the one GIC_CPU::init()
+    // masks, so level 0 is the highest of PRIORITIES levels.
+    static const unsigned int PRIORITY_BITS = 4;
+    static const unsigned int PRIORITIES = (1 << PRIORITY_BITS) - 1;
+
 public:
     // IRQs
     static const unsigned int IRQS = Traits<IC>::IRQS;
@@ -138,6 +147,7 @@ public:
         ICDICER1                    = 0x184,    // Interrupt Clear-Enable       r/w     0x00000000
         ICDICER2                    = 0x188,    // Interrupt Clear-Enable       r/w     0x00000000
         ICDICERn                    = 0x19c,    // Interrupt Clear-Enable       r/w     0x00000000
+        ICDIPR0                     = 0x400,    // Interrupt Priority (1 byte)  r/w     0x00000000
         ICDSGIR                     = 0xf00     // Software Generated Interrupt
     };
 
@@ -177,6 +187,9 @@ public:
     int irq2int(int i) { return i; }
     int int2irq(int i) { return i; }
 
+    void priority(Interrupt_Id id, unsigned int p) { gic_dist8(ICDIPR0 + id) = p << (8 - PRIORITY_BITS); }
+    unsigned int priority(Interrupt_Id id) { return gic_dist8(ICDIPR0 + id) >> (8 - PRIORITY_BITS); }
+
     void send_sgi(unsigned int cpu, Interrupt_Id id) {
         Reg32 target_list = 1 << cpu;
         Reg32 filter_list = 0;
@@ -215,6 +228,7 @@ public:
 
 protected:
     volatile Reg32 & gic_dist(unsigned int o) { return reinterpret_cast<volatile Reg32 *>(this)[o / sizeof(Reg32)]; }
+    volatile Reg8 & gic_dist8(unsigned int o) { return reinterpret_cast<volatile Reg8 *>(this)[o]; }
 
     // The versions bellow are dynamic and work on any A9, but are quite inefficient
     //    static volatile Reg32 & gic_dist(unsigned int offset) {
@@ -237,9 +251,13 @@ public:
         return icciar;
     }
 
+    // Only interrupts of higher priority than p are signaled while masked at p (PRIORITIES masks none)
+    void mask(unsigned int p) { gic_cpu(ICCPMR) = p << (8 - PRIORITY_BITS); }
+    unsigned int mask() { return gic_cpu(ICCPMR) >> (8 - PRIORITY_BITS); }
+
     void init() {
         // Mask no interrupts
-        gic_cpu(ICCPMR) = 0xf0;
+        gic_cpu(ICCPMR) = PRIORITIES << (8 - PRIORITY_BITS);
 
         // Enable interrupts signaling by the CPU interfaces to the connected processors
         gic_cpu(ICCICR) = ACK_CTL | ITF_EN_NS | ITF_EN_S;
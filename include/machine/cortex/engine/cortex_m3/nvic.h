@@ -16,6 +16,7 @@ class NVIC: public IC_Common
     // Use with something like "new (Memory_Map::SCB_BASE) NVIC".
 
 private:
+    typedef CPU::Reg8 Reg8;
     typedef CPU::Reg32 Reg32;
 
 public:
@@ -60,6 +61,14 @@ public:
         IRQ_LAST        = IRQ_UDMAERR
     };
 
+    // Priorities
+    // Only the upper PRIORITY_BITS of each priority byte are implemented (3 on
+    // both the CC2538 and the LM3S811). The highest hardware priority (0) is
+    // left to SVCall, which IC::entry() uses to leave interrupts, so it is
+    // never masked. Level 0 is thus the highest of PRIORITIES levels.
+    static const unsigned int PRIORITY_BITS = 3;
+    static const unsigned int PRIORITIES = (1 << PRIORITY_BITS) - 1;
+
     // Registers' offsets in System Control Space
     enum {                              // Description                                          Type    Value after reset
         IRQ_ENABLE0     = 0x100,        // Interrupt  0-31 Set Enable                           R/W     0x00000000
@@ -77,6 +86,8 @@ public:
         IRQ_ACTIVE0     = 0x300,        // Interrupt  0-31 Active Bit                           R/W     0x00000000
         IRQ_ACTIVE1     = 0x304,        // Interrupt 32-63 Active Bit                           R/W     0x00000000
         IRQ_ACTIVE2     = 0x308,        // Interrupt 64-95 Active Bit                           R/W     0x00000000
+        IRQ_PRIORITY0   = 0x400,        // Interrupt 0 Priority (one byte per interrupt)        R/W     0x00
+        SHPR1           = 0xd18,        // System Handler 4-7 Priority (one byte per handler)   R/W     0x00000000
         SWTRIG          = 0xf00         // Software Trigger Interrupt Register                  WO      0x00000000
     };
 
@@ -114,6 +125,23 @@ public:
         }
     }
 
+    // Priorities of exceptions below EXC_MPU are fixed
+    void priority(Interrupt_Id id, unsigned int p) {
+        if(id >= ARMv7_M::EXC_MPU)
+            priority_reg(id) = (p + 1) << (8 - PRIORITY_BITS);
+    }
+    unsigned int priority(Interrupt_Id id) {
+        Reg8 p = (id >= ARMv7_M::EXC_MPU) ? priority_reg(id) >> (8 - PRIORITY_BITS) : 0;
+        return p ? p - 1 : 0;
+    }
+
+    // Interrupts of priority p or lower are held pending while masked at p (PRIORITIES masks none)
+    static void mask(unsigned int p) { CPU::basepri((p < PRIORITIES) ? (p + 1) << (8 - PRIORITY_BITS) : 0); }
+    static unsigned int mask() {
+        Reg32 basepri = CPU::basepri();
+        return basepri ? (basepri >> (8 - PRIORITY_BITS)) - 1 : PRIORITIES;
+    }
+
     int irq2int(int i) const { return i + HARD_INT; }
     int int2irq(int i) const { return i - HARD_INT; }
 
@@ -137,6 +165,10 @@ protected:
     }
 
 private:
+    volatile Reg8 & priority_reg(Interrupt_Id id) {
+        return (id >= HARD_INT) ? reinterpret_cast<volatile Reg8 *>(this)[IRQ_PRIORITY0 + int2irq(id)] : reinterpret_cast<volatile Reg8 *>(this)[SHPR1 + id - ARMv7_M::EXC_MPU];
+    }
+
     volatile Reg32 & nvic (unsigned int o) { return reinterpret_cast<volatile Reg32 *>(this)[o / sizeof(Reg32)]; }
 };
 
@@ -59,6 +59,9 @@ template<> struct Traits<IC>: public Traits<Machine_Common>
 
     static const unsigned int IRQS = 48;
     static const unsigned int INTS = 65;
+
+    static const bool nested = false;    // preempt handlers only by interrupts of higher priority (see IC::priority())
+    static const bool histogram = false; // keep per-interrupt latency histograms (see IC::latency())
 };
 
 template<> struct Traits<Timer>: public Traits<Machine_Common>
@@ -110,6 +113,8 @@ template<> struct Traits<Serial_Keyboard>: public Traits<Machine_Common>
 template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
 {
     static const bool enabled = false;
+    static const unsigned int ADDRESS = 0;
+    static const unsigned int SIZE = 0;
 };
 
 __END_SYS
@@ -70,6 +70,13 @@ public:
     static Interrupt_Id irq2int(Interrupt_Id id) { return id; }
     static Interrupt_Id int2irq(Interrupt_Id irq) { return irq; }
 
+    // The BCM2836 controllers have no interrupt priorities
+    static const unsigned int PRIORITIES = 1;
+    static void priority(Interrupt_Id id, unsigned int p) {}
+    static unsigned int priority(Interrupt_Id id) { return 0; }
+    static void mask(unsigned int p) {}
+    static unsigned int mask() { return PRIORITIES; }
+
     static void ipi(unsigned int cpu, Interrupt_Id id) { mbox()->ipi(cpu, id); }
 
     static void mailbox_eoi(Interrupt_Id id) {mbox()->eoi(id); }
@@ -65,6 +65,9 @@ template <> struct Traits<IC>: public Traits<Machine_Common>
 
     static const unsigned int IRQS = 96;
     static const unsigned int INTS = 128;
+
+    static const bool nested = false;    // BCM2836 controllers have no priorities
+    static const bool histogram = false; // keep per-interrupt latency histograms (see IC::latency())
 };
 
 template<> struct Traits<Timer>: public Traits<Machine_Common>
@@ -118,6 +121,8 @@ template<> struct Traits<Serial_Keyboard>: public Traits<Machine_Common>
 template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
 {
     static const bool enabled = false;
+    static const unsigned int ADDRESS = 0;
+    static const unsigned int SIZE = 0;
 };
 
 template<> struct Traits<Ethernet>: public Traits<Machine_Common>
@@ -49,6 +49,12 @@ public:
     static Interrupt_Id irq2int(Interrupt_Id id) { return gic_distributor()->irq2int(id); }
     static Interrupt_Id int2irq(Interrupt_Id irq) { return gic_distributor()->int2irq(irq); }
 
+    static const unsigned int PRIORITIES = GIC::PRIORITIES;
+    static void priority(Interrupt_Id id, unsigned int p) { gic_distributor()->priority(id, p); }
+    static unsigned int priority(Interrupt_Id id) { return gic_distributor()->priority(id); }
+    static void mask(unsigned int p) { gic_cpu()->mask(p); }
+    static unsigned int mask() { return gic_cpu()->mask(); }
+
     static void ipi(unsigned int cpu, Interrupt_Id id) { gic_distributor()->send_sgi(cpu, id); }
 
     static void init() {
@@ -530,6 +530,13 @@ public:
         Engine::disable(i);
     }
 
+    // Interrupts don't nest by priority here (see the Cortex IC)
+    typedef unsigned int Priority;
+    static const bool nested = false;
+    enum { UNMASKED = 0 };
+    static Priority mask() { return UNMASKED; }
+    static void mask(const Priority &) {}
+
     using Engine::ipi;
     using Engine::irq2int;
 
@@ -545,6 +552,7 @@ private:
     static void exc_pf (Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error);
     static void exc_gpf(Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error);
     static void exc_fpu(Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error);
+    static void exc_nodev();
 
     static void init();
 
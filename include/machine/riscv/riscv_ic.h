@@ -98,6 +98,13 @@ public:
         disable();
     }
 
+    // Interrupts don't nest by priority here (see the Cortex IC)
+    typedef unsigned int Priority;
+    static const bool nested = false;
+    enum { UNMASKED = 0 };
+    static Priority mask() { return UNMASKED; }
+    static void mask(const Priority &) {}
+
     static Interrupt_Id int_id() {
         // Id is retrieved from mcause even if mip has the equivalent bit up, because only mcause can tell if it is an interrupt or an exception
         Reg id = CPU::mcause();
@@ -124,7 +131,7 @@ public:
     }
 
 private:
-    static void dispatch();
+    static void dispatch(Interrupt_Id id);
 
     // Logical handlers
     static void int_not(Interrupt_Id i);
@@ -4,6 +4,7 @@
 #define __riscv_timer_h
 
 #include <architecture/cpu.h>
+#include <architecture/tsc.h>
 #include <machine/ic.h>
 #include <machine/timer.h>
 #include <system/memory_map.h>
@@ -23,11 +24,19 @@ protected:
     static const unsigned int FREQUENCY = Traits<Timer>::FREQUENCY;
 
     typedef IC_Common::Interrupt_Id Interrupt_Id;
+    typedef TSC::Time_Stamp Time_Stamp;
 
 public:
     using Timer_Common::Tick;
     using Timer_Common::Handler;
 
+    // In tickless mode, each hart's MTIMECMP is programmed for the earliest
+    // deadline among the channels, instead of for the next tick. Channels are
+    // either retriggered (e.g. SCHEDULER) or reprogrammed by their owners
+    // (e.g. ALARM, see program()). Harts share channels, so this mode is
+    // restricted to single-core configurations.
+    static const bool tickless = Traits<Timer>::tickless && !Traits<System>::multicore;
+
     // Channels
     enum {
         SCHEDULER,
@@ -48,6 +57,11 @@ protected:
 
         for(unsigned int i = 0; i < Traits<Machine>::CPUS; i++)
             _current[i] = _initial;
+
+        if(tickless) {
+            _deadline = retrigger ? TSC::time_stamp() + period() : 0;
+            compare();
+        }
     }
 
 public:
@@ -59,7 +73,22 @@ public:
 
     Tick read() { return _current[CPU::id()]; }
 
-    static void reset() { config(FREQUENCY); }
+    static void reset() {
+        if(tickless)
+            compare();
+        else
+            config(FREQUENCY);
+    }
+
+    // Next interrupt of the channel in "ticks" (0 stops the channel)
+    void program(const Tick & ticks) {
+        if(tickless) {
+            _deadline = ticks ? TSC::time_stamp() + Time_Stamp(ticks) * (CLOCK / FREQUENCY) : 0;
+            compare();
+        }
+    }
+
+    void stop() { program(0); }
 
     static void enable() {}
     static void disable() {}
@@ -80,11 +109,29 @@ private:
 
     static void init();
 
+protected:
+    // Programs MTIMECMP for the earliest deadline among all channels
+    static void compare() {
+        Time_Stamp next = ~Time_Stamp(0);
+        for(unsigned int i = 0; i < CHANNELS; i++)
+            if(_channels[i] && _channels[i]->_deadline && (_channels[i]->_deadline < next))
+                next = _channels[i]->_deadline;
+
+        // Writing the high word last avoids a spurious match in between
+        volatile CPU::Reg32 * cmp = &reg(MTIMECMP + MTIMECMP_CORE_OFFSET * CPU::id());
+        cmp[1] = ~0U;
+        cmp[0] = next;
+        cmp[1] = next >> 32;
+    }
+
+    Time_Stamp period() const { return Time_Stamp(_initial) * (CLOCK / FREQUENCY); }
+
 protected:
     unsigned int _channel;
     Tick _initial;
     bool _retrigger;
     volatile Tick _current[Traits<Build>::CPUS];
+    volatile Time_Stamp _deadline; // tickless only
     Handler _handler;
 
     static Timer * _channels[CHANNELS];
@@ -99,8 +146,16 @@ public:
     int restart() {
         db<Timer>(TRC) << "Timer::restart() => {f=" << frequency() << ",h=" << reinterpret_cast<void *>(_handler) << ",count=" << _current[CPU::id()] << "}" << endl;
 
-        int percentage = _current[CPU::id()] * 100 / _initial;
-        _current[CPU::id()] = _initial;
+        int percentage;
+        if(tickless) {
+            Time_Stamp now = TSC::time_stamp();
+            percentage = (_deadline > now) ? (_deadline - now) * 100 / period() : 0;
+            _deadline = now + period();
+            compare();
+        } else {
+            percentage = _current[CPU::id()] * 100 / _initial;
+            _current[CPU::id()] = _initial;
+        }
 
         return percentage;
     }
@@ -113,7 +168,8 @@ public:
     static const unsigned int FREQUENCY = Timer::FREQUENCY;
 
 public:
-    Alarm_Timer(const Handler & handler): Timer(ALARM, FREQUENCY, handler) {}
+    // Tickless alarms are one-shot, reprogrammed by Alarm after each event
+    Alarm_Timer(const Handler & handler): Timer(ALARM, FREQUENCY, handler, !tickless) {}
 };
 
 __END_SYS
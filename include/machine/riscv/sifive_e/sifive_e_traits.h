@@ -75,6 +75,11 @@ template <> struct Traits<Timer>: public Traits<Machine_Common>
     // choice must respect the scheduler time-slice, i. e., it must be higher
     // than the scheduler invocation frequency.
     static const int FREQUENCY = 1000; // Hz
+
+    // Tickless (one-shot) operation: MTIMECMP is programmed for the next due
+    // event (scheduler quantum or alarm) instead of for every tick. FREQUENCY
+    // remains the resolution of Alarm. Ignored in multicore configurations.
+    static const bool tickless = false;
 };
 
 template <> struct Traits<UART>: public Traits<Machine_Common>
@@ -105,6 +110,8 @@ template<> struct Traits<Serial_Display>: public Traits<Machine_Common>
 template<> struct Traits<Scratchpad>: public Traits<Machine_Common>
 {
     static const bool enabled = false;
+    static const unsigned int ADDRESS = 0;
+    static const unsigned int SIZE = 0;
 };
 
 __END_SYS
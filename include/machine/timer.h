@@ -24,6 +24,11 @@ public:
     typedef int Tick;
     typedef IC_Common::Interrupt_Handler Handler;
 
+    // Tickless timers (see Traits<Timer>::tickless) interrupt only when some
+    // channel is due instead of at every tick. Periodic ones ignore program()
+    // and stop().
+    static const bool tickless = false;
+
 protected:
     Timer_Common() {}
 
@@ -39,6 +44,9 @@ public:
     void frequency(const Hertz & f);
 
     void handler(const Handler & handler);
+
+    void program(const Tick & ticks) {}
+    void stop() {}
 };
 
 __END_SYS
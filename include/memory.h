@@ -0,0 +1,61 @@
+// EPOS Memory Abstraction Declarations
+
+#ifndef __memory_h
+#define __memory_h
+
+#include <architecture.h>
+
+__BEGIN_SYS
+
+class Segment;
+
+// Address spaces are MMU directories: segments are attached to them, either
+// at the first free range or at a given address, and activating one (e.g.
+// when switching tasks) makes its mappings the current ones.
+class Address_Space: private MMU::Directory
+{
+public:
+    typedef CPU::Phy_Addr Phy_Addr;
+    typedef CPU::Log_Addr Log_Addr;
+
+public:
+    Address_Space();
+    Address_Space(MMU::Page_Directory * pd);
+    ~Address_Space();
+
+    using MMU::Directory::pd;
+    using MMU::Directory::activate;
+
+    Log_Addr attach(Segment * seg);
+    Log_Addr attach(Segment * seg, const Log_Addr & addr);
+    void detach(Segment * seg);
+    void detach(Segment * seg, const Log_Addr & addr);
+
+    Phy_Addr physical(const Log_Addr & address);
+};
+
+
+// Segments are MMU chunks: contiguous segments (Flags::CT) of suitable sizes
+// are mapped with large pages by MMUs that support them.
+class Segment: public MMU::Chunk
+{
+private:
+    typedef MMU::Chunk Chunk;
+
+public:
+    typedef MMU::Flags Flags;
+    typedef CPU::Phy_Addr Phy_Addr;
+
+public:
+    Segment(unsigned int bytes, const Flags & flags = Flags::APP);
+    Segment(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & flags);
+    ~Segment();
+
+    unsigned int size() const;
+    Phy_Addr phy_address() const;
+    int resize(int amount);
+};
+
+__END_SYS
+
+#endif
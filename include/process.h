@@ -7,6 +7,8 @@
 #include <machine.h>
 #include <utility/queue.h>
 #include <utility/handler.h>
+#include <utility/heap.h>
+#include <scheduler.h>
 
 extern "C" { void __exit(); }
 
@@ -16,18 +18,33 @@ class Thread
 {
     friend class Init_First;            // context->load()
     friend class Init_System;           // for init() on CPU != 0
-    friend class Synchronizer_Common;   // for lock() and sleep()
-    friend class Alarm;                 // for lock()
+    friend class Synchronizer_Common;   // for lock(), sleep() and prioritize()
+    friend class Alarm;                 // for lock(), sleep() and wakeup()
     friend class System;                // for init()
+    friend class Scheduler<Thread>;     // for link()
+    friend class Softirq;               // for running() and _softirqs
+    friend class Interrupt_Thread;      // for lock(), sleep() and wakeup()
 
 protected:
+    static const bool smp = Traits<Thread>::smp;
     static const bool reboot = Traits<System>::reboot;
+    static const bool preemptive = Traits<Thread>::Criterion::preemptive;
+    static const bool pooled = Traits<Thread>::pooled;
+    static const bool guarded = Traits<Thread>::guarded;
+    static const bool lazy_fpu = Traits<FPU>::enabled && Traits<FPU>::lazy;
 
     static const unsigned int QUANTUM = Traits<Thread>::QUANTUM;
     static const unsigned int STACK_SIZE = Traits<Application>::STACK_SIZE;
+    static const unsigned int STACK_POOL = pooled ? Traits<Application>::MAX_THREADS : 1;
+
+    // Stack canaries (see Traits<Thread>::guarded) follow the exit status,
+    // which is kept in the first word of the stack
+    static const unsigned int CANARIES = 4;
+    static const unsigned int CANARY = 0xdeadbeef;
 
     typedef CPU::Log_Addr Log_Addr;
     typedef CPU::Context Context;
+    typedef CPU::FPU_Context FPU_Context;
 
 public:
     // Thread State
@@ -39,25 +56,29 @@ public:
         FINISHING
     };
 
-    // Thread Priority
-    typedef unsigned int Priority;
+    // Thread Scheduling Criterion
+    typedef Traits<Thread>::Criterion Criterion;
     enum {
-        HIGH = 0,
-        NORMAL = 15,
-        LOW = 31
+        HIGH    = Criterion::HIGH,
+        NORMAL  = Criterion::NORMAL,
+        LOW     = Criterion::LOW,
+        IDLE    = Criterion::IDLE
     };
 
     // Thread Queue
-    typedef Ordered_Queue<Thread, Priority> Queue;
+    typedef Ordered_Queue<Thread, Criterion, Scheduler<Thread>::Element> Queue;
 
     // Thread Configuration
+    // The affinity mask (bit i set means CPU i allowed) restricts the CPUs on
+    // which the thread can run, if the multicore criterion supports it
     struct Configuration {
-        Configuration(const State & s = READY, const Priority & p = NORMAL, unsigned int ss = STACK_SIZE)
-        : state(s), priority(p), stack_size(ss) {}
+        Configuration(const State & s = READY, const Criterion & c = NORMAL, unsigned int ss = STACK_SIZE, unsigned int a = Criterion::ANY)
+        : state(s), criterion(c), stack_size(ss), affinity(a) {}
 
         State state;
-        Priority priority;
+        Criterion criterion;
         unsigned int stack_size;
+        unsigned int affinity;
     };
 
 
@@ -70,8 +91,10 @@ public:
 
     const volatile State & state() const { return _state; }
 
-    const volatile Priority & priority() const { return _link.rank(); }
-    void priority(const Priority & p);
+    const volatile Criterion & priority() const { return _link.rank(); }
+    void priority(const Criterion & p);
+
+    Criterion & criterion() { return const_cast<Criterion &>(_link.rank()); }
 
     int join();
     void pass();
@@ -86,52 +109,100 @@ protected:
     void constructor_prologue(unsigned int stack_size);
     void constructor_epilogue(const Log_Addr & entry, unsigned int stack_size);
 
-    static Thread * volatile running() { return _running; }
-
-    static void lock() { CPU::int_disable(); }
-    static void unlock() { CPU::int_enable(); }
-    static bool locked() { return CPU::int_disabled(); }
+    Queue::Element * link() { return &_link; }
+
+    void prioritize(const Criterion & c);
+
+    bool overflown() const {
+        for(unsigned int i = 1; i <= CANARIES; i++)
+            if(reinterpret_cast<unsigned int *>(_stack)[i] != CANARY)
+                return true;
+        return false;
+    }
+
+    static Thread * volatile running() { return _scheduler.chosen(); }
+
+    // In multicores, the kernel is additionally serialized by a spin lock
+    // that remains taken across context switches, being released by the
+    // thread that resumes execution on the same CPU (see entry())
+    static void lock() {
+        CPU::int_disable();
+        if(smp)
+            _lock.acquire();
+    }
+    static void unlock() {
+        if(smp)
+            _lock.release();
+        CPU::int_enable();
+    }
+    static bool locked() { return smp ? _lock.held() : CPU::int_disabled(); }
+
+    static void sleep(Queue * q);
+    static void wakeup(Queue * q, bool preempt = true);
+    static void wakeup_all(Queue * q);
 
     static void reschedule();
+    static void reschedule(unsigned int queue, bool preempt = true);
+    static void rescheduler(IC::Interrupt_Id interrupt);
     static void time_slicer(IC::Interrupt_Id interrupt);
 
-    static void dispatch(Thread * prev, Thread * next);
+    static void dispatch(Thread * prev, Thread * next, bool charge = true);
 
     static int idle();
 
 private:
+    // New threads start with the lock taken by the CPU that dispatched them
+    template<typename ... Tn>
+    static int entry(int (* function)(Tn ...), Tn ... an) {
+        unlock();
+        return function(an ...);
+    }
+
     static void init();
 
 protected:
     char * _stack;
+    unsigned int _stack_size;
     Context * volatile _context;
+    FPU_Context * _fpu; // only with lazy FPU switching (see CPU::fpu_switch())
+    volatile bool _softirqs; // draining softirqs (see Softirq::drain())
     volatile State _state;
+    Queue * _waiting;
+    Thread * volatile _joining;
     Queue::Element _link;
 
+    static volatile unsigned int _thread_count;
     static Scheduler_Timer * _timer;
-
-private:
-    static Thread * volatile _running;
-    static Queue _ready;
-    static Queue _suspended;
+    static Scheduler<Thread> _scheduler;
+    static CPU_Spin _lock;
+    static Block_Cache<STACK_POOL> _stacks;
 };
 
 
 template<typename ... Tn>
 inline Thread::Thread(int (* entry)(Tn ...), Tn ... an)
-: _state(READY), _link(this, NORMAL)
+: _state(READY), _waiting(0), _joining(0), _link(this, NORMAL)
 {
     constructor_prologue(STACK_SIZE);
-    _context = CPU::init_stack(0, _stack + STACK_SIZE, &__exit, entry, an ...);
+    if(smp)
+        _context = CPU::init_stack(0, _stack + STACK_SIZE, &__exit, &Thread::entry<Tn ...>, entry, an ...);
+    else
+        _context = CPU::init_stack(0, _stack + STACK_SIZE, &__exit, entry, an ...);
     constructor_epilogue(entry, STACK_SIZE);
 }
 
 template<typename ... Tn>
 inline Thread::Thread(const Configuration & conf, int (* entry)(Tn ...), Tn ... an)
-: _state(conf.state), _link(this, conf.priority)
+: _state(conf.state), _waiting(0), _joining(0), _link(this, conf.criterion)
 {
+    if(conf.affinity != Criterion::ANY)
+        criterion().affinity(conf.affinity);
+
     constructor_prologue(conf.stack_size);
-    _context = CPU::init_stack(0, _stack + conf.stack_size, &__exit, entry, an ...);
+    if(smp)
+        _context = CPU::init_stack(0, _stack + conf.stack_size, &__exit, &Thread::entry<Tn ...>, entry, an ...);
+    else
+        _context = CPU::init_stack(0, _stack + conf.stack_size, &__exit, entry, an ...);
     constructor_epilogue(entry, conf.stack_size);
 }
 
@@ -0,0 +1,122 @@
+// EPOS Real-time Declarations
+
+#ifndef __real_time_h
+#define __real_time_h
+
+#include <utility/handler.h>
+#include <process.h>
+#include <time.h>
+
+__BEGIN_SYS
+
+// Periodic threads are released by an Alarm at every period and stay
+// suspended between jobs (see wait_next()). The response time of each job is
+// taken from its nominal release, with the resolution of Alarm, and checked
+// against the thread's deadline.
+class Periodic_Thread: public Thread
+{
+protected:
+    typedef Timer_Common::Tick Tick;
+
+public:
+    // Constructor helpers
+    enum : unsigned int {
+        SAME    = Criterion::SAME,
+        NOW     = Criterion::NOW,
+        UNKNOWN = Criterion::UNKNOWN
+    };
+
+    // Thread Configuration
+    struct Configuration: public Thread::Configuration {
+        Configuration(const Microsecond & p, const Microsecond & d = SAME, const Microsecond & c = UNKNOWN, const Microsecond & a = NOW, unsigned int n = INFINITE, const State & s = READY, unsigned int ss = STACK_SIZE)
+        : Thread::Configuration(s, Criterion(d ? d : p, p, c), ss), period(p), deadline(d ? d : p), capacity(c), activation(a), times(n) {}
+
+        Microsecond period;
+        Microsecond deadline;
+        Microsecond capacity;
+        Microsecond activation;
+        unsigned int times;
+    };
+
+public:
+    template<typename ... Tn>
+    Periodic_Thread(const Microsecond & p, int (* entry)(Tn ...), Tn ... an)
+    : Periodic_Thread(Configuration(p), entry, an ...) {}
+
+    template<typename ... Tn>
+    Periodic_Thread(const Configuration & conf, int (* entry)(Tn ...), Tn ... an)
+    : Thread(Thread::Configuration(SUSPENDED, conf.criterion, conf.stack_size, conf.affinity), entry, an ...),
+      _period(conf.period), _deadline(Alarm::ticks(conf.deadline)), _times(conf.times), _pending(0),
+      _waiting(conf.activation), _activation(conf.activation), _release(Alarm::elapsed()),
+      _jobs(0), _misses(0), _min_response(0), _max_response(0), _total_response(0),
+      _handler(&release, this), _alarm(conf.activation ? conf.activation : conf.period, &_handler, conf.times) {
+        // Threads with an activation time are resumed by their first release
+        if((conf.state == READY) && !_activation)
+            resume();
+    }
+
+    const Microsecond & period() const { return _period; }
+    void period(const Microsecond & p) { _period = p; _alarm.period(p); }
+
+    // Job statistics
+    unsigned int jobs() const { return _jobs; }
+    unsigned int deadline_misses() const { return _misses; }
+    Microsecond min_response_time() const { return _min_response * Alarm::timer_period(); }
+    Microsecond max_response_time() const { return _max_response * Alarm::timer_period(); }
+    Microsecond avg_response_time() const { return _jobs ? _total_response / _jobs * Alarm::timer_period() : 0; }
+
+    // Deadline misses of all periodic threads (i.e. System_Event DEADLINE_MISSES)
+    static unsigned int total_deadline_misses() { return _deadline_misses; }
+
+    // Ends the current job and waits for the next release
+    // Returns false after the last job (see Configuration::times)
+    static volatile bool wait_next();
+
+protected:
+    void account(const Tick & response);
+
+    static void release(Periodic_Thread * t);
+
+protected:
+    Microsecond _period;
+    Tick _deadline;
+    volatile unsigned int _times;
+    volatile unsigned int _pending;
+    volatile bool _waiting;
+    volatile bool _activation;
+    Tick _release;
+
+    unsigned int _jobs;
+    unsigned int _misses;
+    Tick _min_response;
+    Tick _max_response;
+    Tick _total_response;
+
+    Functor_Handler<Periodic_Thread> _handler;
+    Alarm _alarm;
+
+    static volatile unsigned int _deadline_misses;
+};
+
+
+// Real-time threads run a function once per period (i.e. a job), optionally
+// after an activation time and for a limited number of times
+class RT_Thread: public Periodic_Thread
+{
+public:
+    RT_Thread(void (* function)(), const Microsecond & deadline, const Microsecond & period = SAME, const Microsecond & capacity = UNKNOWN, const Microsecond & activation = NOW, unsigned int times = INFINITE, unsigned int stack_size = STACK_SIZE)
+    : Periodic_Thread(Configuration(period ? period : deadline, deadline, capacity, activation, times, READY, stack_size), &entry, function) {}
+
+private:
+    static int entry(void (* function)()) {
+        do
+            function();
+        while(wait_next());
+
+        return 0;
+    }
+};
+
+__END_SYS
+
+#endif
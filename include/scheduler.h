@@ -0,0 +1,387 @@
+// EPOS Scheduler Component Declarations
+
+#ifndef __scheduler_h
+#define __scheduler_h
+
+#include <architecture/cpu.h>
+#include <utility/scheduling.h>
+
+__BEGIN_SYS
+
+// All scheduling criteria, or disciplines, must define operator int() with
+// the semantics of returning the desired order of a given object within the
+// scheduling list
+class Scheduling_Criterion_Common
+{
+public:
+    // Priorities
+    enum : int {
+        HIGH    = 0,
+        NORMAL  = 15,
+        LOW     = 31,
+        IDLE    = 32
+    };
+
+    // Constructor helpers
+    enum : unsigned int {
+        SAME    = 0,
+        NOW     = 0,
+        UNKNOWN = 0,
+        ANY     = -1U
+    };
+
+    // Characteristics
+    static const bool timed = false;
+    static const bool dynamic = false;
+    static const bool preemptive = true;
+    static const bool multilevel = false;
+
+    // Multicore criteria have one queue per CPU (or cluster of CPUs), each
+    // with one head (i.e. running object) per CPU serving the queue
+    static const unsigned int QUEUES = 1;
+    static const unsigned int HEADS = 1;
+
+protected:
+    Scheduling_Criterion_Common() {}
+
+public:
+    Microsecond period() const { return 0; }
+    void period(const Microsecond & p) {}
+
+    unsigned int queue() const { return 0; }
+    void queue(unsigned int q) {}
+
+    // CPU affinity masks (bit i set means CPU i allowed) are only meaningful
+    // for multiqueue criteria, i.e. those that can tell CPUs apart
+    unsigned int affinity() const { return ANY; }
+    void affinity(unsigned int mask) {}
+    bool affine(unsigned int queue) const { return true; }
+
+    // Renews dynamic ranks for a job released at the given time (in Alarm ticks)
+    void update(int release) {}
+
+    static unsigned int current_queue() { return 0; }
+    static unsigned int current_head() { return 0; }
+
+    static void init() {}
+};
+
+// Priority (static)
+// Ranks are small integers in [HIGH, IDLE], so criteria derived from Priority
+// can use the constant-time multilevel scheduling list (see Traits<Thread>)
+class Priority: public Scheduling_Criterion_Common
+{
+public:
+    static const bool multilevel = Traits<Thread>::multilevel;
+    static const unsigned int LEVELS = IDLE + 1;
+
+public:
+    Priority(int p = NORMAL): _priority(p) {}
+    // Periodic threads (see real-time.h) are ranked as NORMAL ones, since
+    // priorities do not derive from timing parameters
+    Priority(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY): _priority(NORMAL) {}
+
+    operator const volatile int() const volatile { return _priority; }
+
+protected:
+    volatile int _priority;
+};
+
+// Round-Robin
+class RR: public Priority
+{
+public:
+    static const bool timed = true;
+    static const bool dynamic = false;
+    static const bool preemptive = true;
+
+public:
+    RR(int p = NORMAL): Priority(p) {}
+    RR(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY): Priority(NORMAL) {}
+};
+
+// Multiqueue criteria (multicore) keep the queue in which each object resides
+class Variable_Queue_Scheduler
+{
+protected:
+    Variable_Queue_Scheduler(unsigned int queue): _queue(queue) {}
+
+public:
+    unsigned int queue() const { return _queue; }
+    void queue(unsigned int q) { _queue = q; }
+
+protected:
+    // The current CPU, if allowed by mask, or else the first allowed one
+    static unsigned int select(unsigned int mask) {
+        if(mask & (1 << CPU::id()))
+            return CPU::id();
+        unsigned int cpu = 0;
+        while((cpu < Traits<Machine>::CPUS - 1) && !(mask & (1 << cpu)))
+            cpu++;
+        return cpu;
+    }
+
+protected:
+    volatile unsigned int _queue;
+};
+
+// Global Round-Robin (multicore)
+// Each CPU has its own ready queue, so scheduling decisions are local to
+// CPUs. Threads start in the queue of the CPU that created them and migrate
+// when idle CPUs steal them (see Scheduler::steal()), though only among the
+// CPUs in their affinity mask. Single-queue criteria are not meant for
+// multicores, for they have a single running thread.
+class GRR: public RR, public Variable_Queue_Scheduler
+{
+public:
+    static const unsigned int QUEUES = Traits<Machine>::CPUS;
+
+public:
+    GRR(int p = NORMAL): RR(p), Variable_Queue_Scheduler(CPU::id()), _affinity(ANY) {}
+    GRR(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : RR(d, p, c, cpu), Variable_Queue_Scheduler((cpu != ANY) ? cpu : CPU::id()), _affinity(ANY) {}
+
+    using Variable_Queue_Scheduler::queue;
+
+    unsigned int affinity() const { return _affinity; }
+    void affinity(unsigned int mask) {
+        _affinity = mask;
+        if(!affine(_queue))
+            _queue = select(mask);
+    }
+    bool affine(unsigned int queue) const { return _affinity & (1 << queue); }
+
+    static unsigned int current_queue() { return CPU::id(); }
+
+protected:
+    volatile unsigned int _affinity;
+};
+
+// CPU Affinity (multicore)
+// Global Round-Robin with threads restricted to a set of CPUs
+class CPU_Affinity: public GRR
+{
+public:
+    CPU_Affinity(int p = NORMAL, unsigned int mask = ANY): GRR(p) { affinity(mask); }
+    CPU_Affinity(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : GRR(d, p, c, cpu) {}
+};
+
+// Fixed CPU (multicore)
+// Round-Robin with threads pinned to a CPU (by default, their creator's one)
+class Fixed_CPU: public GRR
+{
+public:
+    Fixed_CPU(int p = NORMAL, unsigned int cpu = ANY): GRR(p) { affinity(1 << ((cpu != ANY) ? cpu : CPU::id())); }
+    Fixed_CPU(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : GRR(d, p, c, cpu) { affinity(1 << _queue); }
+};
+
+// First-Come, First-Served (FIFO)
+// Ranks are arrival times (in Alarm ticks), so only IDLE keeps its priority
+class FCFS: public Priority
+{
+public:
+    // Ranks are arrival times, so IDLE must be ranked after any of them
+    enum : int {
+        IDLE    = (unsigned(1) << (sizeof(int) * 8 - 1)) - 1
+    };
+
+    static const bool timed = false;
+    static const bool dynamic = false;
+    static const bool preemptive = false;
+    static const bool multilevel = false;
+
+public:
+    FCFS(int p = NORMAL); // defined at scheduler.cc, since it depends on Alarm
+    FCFS(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY): FCFS(NORMAL) {}
+};
+
+// Real-time Algorithms
+// Ranks of periodic threads are times (either relative or absolute), so
+// aperiodic threads are ranked after any possible periodic one
+class RT_Common: public Priority
+{
+public:
+    // Priorities
+    enum : int {
+        HIGH    = 0,
+        NORMAL  = (unsigned(1) << (sizeof(int) * 8 - 1)) - 3,
+        LOW     = (unsigned(1) << (sizeof(int) * 8 - 1)) - 2,
+        IDLE    = (unsigned(1) << (sizeof(int) * 8 - 1)) - 1
+    };
+
+    // Policy types
+    enum : int {
+        PERIODIC  = HIGH + 1,
+        APERIODIC = NORMAL,
+        SPORADIC  = NORMAL
+    };
+
+    static const bool timed = false;
+    static const bool preemptive = true;
+    static const bool multilevel = false;
+
+protected:
+    RT_Common(int i): Priority(i), _deadline(0), _period(0), _capacity(0) {} // aperiodic
+    RT_Common(int i, const Microsecond & d, const Microsecond & p, const Microsecond & c)
+    : Priority(i), _deadline(d), _period(p), _capacity(c) {}
+
+    // Static ranks of periodic threads must not collide with aperiodic ones
+    static int rank(const Microsecond & t) { return (Time_Base(t) < PERIODIC) ? int(PERIODIC) : (Time_Base(t) >= APERIODIC) ? APERIODIC - 1 : int(t); }
+
+public:
+    Microsecond deadline() const { return _deadline; }
+    Microsecond period() const { return _period; }
+    void period(const Microsecond & p) { _period = p; }
+    Microsecond capacity() const { return _capacity; }
+
+    bool periodic() const { return (_priority >= PERIODIC) && (_priority < APERIODIC); }
+
+protected:
+    Microsecond _deadline;
+    Microsecond _period;
+    Microsecond _capacity;
+};
+
+// Rate Monotonic
+class RM: public RT_Common
+{
+public:
+    static const bool dynamic = false;
+
+public:
+    RM(int p = APERIODIC): RT_Common(p) {}
+    RM(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : RT_Common(rank(p ? p : d), d, p ? p : d, c) {}
+};
+
+// Deadline Monotonic
+class DM: public RT_Common
+{
+public:
+    static const bool dynamic = false;
+
+public:
+    DM(int p = APERIODIC): RT_Common(p) {}
+    DM(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : RT_Common(rank(d), d, p ? p : d, c) {}
+};
+
+// Earliest Deadline First
+// Ranks of periodic threads are absolute deadlines (in Alarm ticks), which
+// are renewed by update() at every job release from its nominal release time,
+// so late releases (e.g. after an overrun) don't postpone them
+class EDF: public RT_Common
+{
+public:
+    static const bool dynamic = true;
+
+public:
+    EDF(int p = APERIODIC): RT_Common(p) {}
+    EDF(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY);
+
+    void update(int release);
+};
+
+// Global Earliest Deadline First (multicore)
+// A single queue with one head per CPU, so the most urgent threads run on
+// whatever CPUs are available. Affinity masks are ignored.
+class GEDF: public EDF
+{
+public:
+    static const unsigned int HEADS = Traits<Machine>::CPUS;
+
+public:
+    GEDF(int p = APERIODIC): EDF(p) {}
+    GEDF(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : EDF(d, p, c, cpu) {}
+
+    static unsigned int current_head() { return CPU::id(); }
+};
+
+// Partitioned criteria (multicore)
+// Threads are assigned to a partition (i.e. a CPU or a cluster of them)
+// when created and never migrate. The partition is given either by the
+// "cpu" parameter of periodic threads, by the first CPU of the affinity mask
+// (see Thread::Configuration) or by the CPU that created the thread.
+template<unsigned int H = 1>
+class Partitioned_Queue_Scheduler: public Variable_Queue_Scheduler
+{
+protected:
+    Partitioned_Queue_Scheduler(unsigned int cpu): Variable_Queue_Scheduler(((cpu != Scheduling_Criterion_Common::ANY) ? cpu : CPU::id()) / H) {}
+
+public:
+    unsigned int affinity() const { return Scheduling_Criterion_Common::ANY; }
+    void affinity(unsigned int mask) {
+        // Threads stay in their partition if any of its CPUs is allowed
+        if(!(mask & (((1 << H) - 1) << (_queue * H))))
+            _queue = select(mask) / H;
+    }
+    bool affine(unsigned int queue) const { return queue == _queue; }
+};
+
+// Partitioned Earliest Deadline First (multicore)
+class PEDF: public EDF, public Partitioned_Queue_Scheduler<>
+{
+public:
+    static const unsigned int QUEUES = Traits<Machine>::CPUS;
+
+public:
+    PEDF(int p = APERIODIC): EDF(p), Partitioned_Queue_Scheduler<>(ANY) {}
+    PEDF(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : EDF(d, p, c, cpu), Partitioned_Queue_Scheduler<>(cpu) {}
+
+    using Partitioned_Queue_Scheduler<>::queue;
+    using Partitioned_Queue_Scheduler<>::affinity;
+    using Partitioned_Queue_Scheduler<>::affine;
+
+    static unsigned int current_queue() { return CPU::id(); }
+};
+
+// Clustered Earliest Deadline First (multicore)
+// One queue per cluster of CPUs (see Traits<Thread>::CLUSTERS), each with
+// one head per CPU in the cluster, i.e. Global EDF within clusters
+class CEDF: public EDF, public Partitioned_Queue_Scheduler<Traits<Machine>::CPUS / Traits<Thread>::CLUSTERS>
+{
+private:
+    typedef Partitioned_Queue_Scheduler<Traits<Machine>::CPUS / Traits<Thread>::CLUSTERS> Base;
+
+public:
+    static const unsigned int QUEUES = Traits<Thread>::CLUSTERS;
+    static const unsigned int HEADS = Traits<Machine>::CPUS / QUEUES;
+
+public:
+    CEDF(int p = APERIODIC): EDF(p), Base(ANY) {}
+    CEDF(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : EDF(d, p, c, cpu), Base(cpu) {}
+
+    using Base::queue;
+    using Base::affinity;
+    using Base::affine;
+
+    static unsigned int current_queue() { return CPU::id() / HEADS; }
+    static unsigned int current_head() { return CPU::id() % HEADS; }
+};
+
+// Partitioned Rate Monotonic (multicore)
+class PRM: public RM, public Partitioned_Queue_Scheduler<>
+{
+public:
+    static const unsigned int QUEUES = Traits<Machine>::CPUS;
+
+public:
+    PRM(int p = APERIODIC): RM(p), Partitioned_Queue_Scheduler<>(ANY) {}
+    PRM(const Microsecond & d, const Microsecond & p = SAME, const Microsecond & c = UNKNOWN, unsigned int cpu = ANY)
+    : RM(d, p, c, cpu), Partitioned_Queue_Scheduler<>(cpu) {}
+
+    using Partitioned_Queue_Scheduler<>::queue;
+    using Partitioned_Queue_Scheduler<>::affinity;
+    using Partitioned_Queue_Scheduler<>::affine;
+
+    static unsigned int current_queue() { return CPU::id(); }
+};
+
+__END_SYS
+
+#endif
@@ -11,8 +11,12 @@ __BEGIN_SYS
 
 class Synchronizer_Common
 {
+protected:
+    typedef Thread::Queue Queue;
+
 protected:
     Synchronizer_Common() {}
+    ~Synchronizer_Common() { begin_atomic(); wakeup_all(); end_atomic(); }
 
     // Atomic operations
     bool tsl(volatile bool & lock) { return CPU::tsl(lock); }
@@ -23,23 +27,61 @@ protected:
     void begin_atomic() { Thread::lock(); }
     void end_atomic() { Thread::unlock(); }
 
-    void sleep() { Thread::yield(); } // implicit unlock()
-    void wakeup() { end_atomic(); }
-    void wakeup_all() { end_atomic(); }
+    // Threads wait in _queue (ordered by Thread::Criterion) in the WAITING state
+    void sleep() { Thread::sleep(&_queue); }
+    void wakeup(bool preempt = true) { Thread::wakeup(&_queue, preempt); }
+    void wakeup_all() { Thread::wakeup_all(&_queue); }
+
+    static Thread * running() { return Thread::running(); }
+    static void prioritize(Thread * t, const Thread::Criterion & c) { t->prioritize(c); }
+    static void reschedule() { if(Thread::preemptive) Thread::reschedule(); }
+
+protected:
+    Queue _queue;
 };
 
 
+// The priority inversion protocol is selected by Traits<Synchronizer>:
+// with INHERITANCE, the owner runs at the priority of its most urgent waiter;
+// with CEILING, the owner runs at the mutex's ceiling while holding it.
+// Nested mutexes must be released in reverse order of acquisition.
 class Mutex: protected Synchronizer_Common
 {
+    friend class Condition;     // for release()
+
+private:
+    static const unsigned int PROTOCOL = Traits<Synchronizer>::PRIORITY_INVERSION_PROTOCOL;
+
+    typedef Thread::Criterion Criterion;
+
 public:
-    Mutex();
+    Mutex(const Criterion & ceiling = Thread::HIGH);
     ~Mutex();
 
     void lock();
     void unlock();
 
+    // Priority boosting statistics
+    unsigned int boosts() const { return _boosts; }
+    Microsecond boost_time() const { return _boost_time * 1000000 / TSC::frequency(); }
+
+private:
+    void acquire(Thread * t);
+    void release(bool preempt = true);
+
+    void boost(const Criterion & c);
+    bool restore();
+
 private:
     volatile bool _locked;
+    Thread * volatile _owner;
+    Criterion _priority; // the owner's, before acquiring the mutex
+    Criterion _ceiling;
+    volatile bool _boosted;
+
+    unsigned int _boosts;
+    TSC::Time_Stamp _boost_start;
+    TSC::Time_Stamp _boost_time;
 };
 
 
@@ -57,8 +99,9 @@ private:
 };
 
 
-// This is actually no Condition Variable
-// check http://www.cs.duke.edu/courses/spring01/cps110/slides/sem/sld002.htm
+// Condition variables have no memory: signal() and broadcast() only release
+// threads already waiting. As in Mesa monitors, woken threads must re-check
+// the condition, since it might have changed before they run.
 class Condition: protected Synchronizer_Common
 {
 public:
@@ -66,6 +109,7 @@ public:
     ~Condition();
 
     void wait();
+    void wait(Mutex * mutex);
     void signal();
     void broadcast();
 };
@@ -7,6 +7,14 @@
 #include <utility/heap.h>
 #include <system/info.h>
 
+// Heap selectors (see below)
+inline void * operator new(size_t bytes, const EPOS::System_Allocator & allocator);
+inline void * operator new(size_t bytes, const EPOS::Scratchpad_Allocator & allocator);
+inline void * operator new(size_t bytes, const EPOS::Uncached_Allocator & allocator);
+inline void * operator new[](size_t bytes, const EPOS::System_Allocator & allocator);
+inline void * operator new[](size_t bytes, const EPOS::Scratchpad_Allocator & allocator);
+inline void * operator new[](size_t bytes, const EPOS::Uncached_Allocator & allocator);
+
 __BEGIN_SYS
 
 class Application
@@ -15,6 +23,10 @@ class Application
     friend void * ::malloc(size_t);
     friend void ::free(void *);
 
+public:
+    // Usage of the application's heap (see Traits<Heaps>::profiled)
+    static const Heap_Profile & heap_profile() { return _heap->profile(); }
+
 private:
     static void init();
 
@@ -28,11 +40,26 @@ class System
     friend class Init_System;
     friend void CPU::Context::load() const volatile;
     friend void * kmalloc(size_t);
+    friend void * try_kmalloc(size_t);
     friend void kfree(void *);
+    friend void * ::operator new(size_t, const EPOS::System_Allocator &);
+    friend void * ::operator new(size_t, const EPOS::Scratchpad_Allocator &);
+    friend void * ::operator new(size_t, const EPOS::Uncached_Allocator &);
+    friend void * ::operator new[](size_t, const EPOS::System_Allocator &);
+    friend void * ::operator new[](size_t, const EPOS::Scratchpad_Allocator &);
+    friend void * ::operator new[](size_t, const EPOS::Uncached_Allocator &);
 
 public:
     static System_Info * const info() { assert(_si); return _si; }
 
+    // Usage of the system's heap (see Traits<Heaps>::profiled)
+    static const Heap_Profile & heap_profile() { return _heap->profile(); }
+
+    // Usage of the heaps for new (SCRATCHPAD) and new (UNCACHED), or of the
+    // system's heap if there isn't one
+    static const Heap_Profile & scratchpad_heap_profile() { return (_scratchpad_heap ? _scratchpad_heap : _heap)->profile(); }
+    static const Heap_Profile & uncached_heap_profile() { return (_uncached_heap ? _uncached_heap : _heap)->profile(); }
+
 private:
     static void init();
 
@@ -40,12 +67,21 @@ private:
     static System_Info * _si;
     static char _preheap[sizeof(Heap)];
     static Heap * _heap;
+    static char _scratchpad_preheap[sizeof(Heap)];
+    static Heap * _scratchpad_heap;     // on-chip memory (Traits<Scratchpad>)
+    static char _uncached_preheap[sizeof(Heap)];
+    static Heap * _uncached_heap;       // DMA-coherent memory (Traits<System>::UNCACHED_HEAP_SIZE)
 };
 
 inline void * kmalloc(size_t bytes) {
     return System::_heap->alloc(bytes);
 }
 
+// As kmalloc(), but returns 0 instead of panicking when the heap is exhausted
+inline void * try_kmalloc(size_t bytes) {
+    return System::_heap->try_alloc(bytes);
+}
+
 inline void kfree(void * ptr) {
     System::_heap->free(ptr);
 }
@@ -81,6 +117,50 @@ inline void * operator new[](size_t bytes) {
     return malloc(bytes);
 }
 
+// Heap selectors: new (SYSTEM), new (SCRATCHPAD), new (UNCACHED) and new (heap)
+// Without a scratchpad or an uncached heap, the system's heap is used instead.
+// Blocks are tagged with their heaps, so delete returns them to where they
+// came from (see Heap)
+inline void * operator new(size_t bytes, const EPOS::System_Allocator & allocator) {
+    return _SYS::System::_heap->alloc(bytes);
+}
+
+inline void * operator new[](size_t bytes, const EPOS::System_Allocator & allocator) {
+    return _SYS::System::_heap->alloc(bytes);
+}
+
+inline void * operator new(size_t bytes, const EPOS::Scratchpad_Allocator & allocator) {
+    return (_SYS::System::_scratchpad_heap ? _SYS::System::_scratchpad_heap : _SYS::System::_heap)->alloc(bytes);
+}
+
+inline void * operator new[](size_t bytes, const EPOS::Scratchpad_Allocator & allocator) {
+    return (_SYS::System::_scratchpad_heap ? _SYS::System::_scratchpad_heap : _SYS::System::_heap)->alloc(bytes);
+}
+
+inline void * operator new(size_t bytes, const EPOS::Uncached_Allocator & allocator) {
+    return (_SYS::System::_uncached_heap ? _SYS::System::_uncached_heap : _SYS::System::_heap)->alloc(bytes);
+}
+
+inline void * operator new[](size_t bytes, const EPOS::Uncached_Allocator & allocator) {
+    return (_SYS::System::_uncached_heap ? _SYS::System::_uncached_heap : _SYS::System::_heap)->alloc(bytes);
+}
+
+// Templates only match pointers to allocators (i.e. to classes with alloc()),
+// thus neither the regular placement new nor Log_Addr (which converts to any
+// pointer), and only accept Heaps, whose blocks delete can return (the others,
+// e.g. Simple_Heap or Arena, would otherwise fall back to placement new)
+template<typename H, typename = decltype(static_cast<H *>(0)->alloc(0U))>
+inline void * operator new(size_t bytes, H * heap) {
+    static_assert(_SYS::EQUAL<H, _SYS::Heap>::Result, "new (heap) requires a Heap, since delete returns blocks to their Heaps");
+    return heap->alloc(bytes);
+}
+
+template<typename H, typename = decltype(static_cast<H *>(0)->alloc(0U))>
+inline void * operator new[](size_t bytes, H * heap) {
+    static_assert(_SYS::EQUAL<H, _SYS::Heap>::Result, "new (heap) requires a Heap, since delete returns blocks to their Heaps");
+    return heap->alloc(bytes);
+}
+
 // Delete cannot be declared inline due to virtual destructors
 void operator delete(void * ptr);
 void operator delete[](void * ptr);
@@ -128,6 +128,9 @@ class Chronometer;
 class Alarm;
 class Delay;
 
+class Softirq;
+class Interrupt_Thread;
+
 template<typename T> class Clerk;
 class Monitor;
 
@@ -195,6 +198,9 @@ struct Traits_Tokens
     // SmartData predictors
     enum :unsigned char {NONE, LVP, DBP};
 
+    // Priority inversion protocols (NONE disables them)
+    enum {INHERITANCE = NONE + 1, CEILING};
+
     // Monitor events (Transducers)
     enum Transducer_Event {
         CPU_TEMPERATURE,
@@ -3,10 +3,12 @@
 #ifndef __time_h
 #define __time_h
 
+#include <architecture/tsc.h>
 #include <machine/rtc.h>
 #include <machine/timer.h>
 #include <utility/queue.h>
 #include <utility/handler.h>
+#include <interrupt.h>
 
 __BEGIN_SYS
 
@@ -32,11 +34,30 @@ class Alarm
     friend class System;                        // for init()
     friend class Alarm_Chronometer;             // for elapsed()
     friend class FCFS;                          // for ticks() and elapsed()
+    friend class EDF;                           // for ticks() and elapsed()
+    friend class Periodic_Thread;               // for ticks(), timer_period() and elapsed()
 
 private:
     typedef Timer_Common::Tick Tick;
     typedef Relative_Queue<Alarm, Tick> Queue;
 
+    // Tickless alarms program the timer for the next due event instead of
+    // counting every tick (see Traits<Timer>::tickless). Elapsed time is then
+    // derived from the TSC and the ranks in _request are relative to _last.
+    static const bool tickless = Alarm_Timer::tickless;
+
+    // Alarms can be kept in a hashed timing wheel instead of in _request, so
+    // arming and cancelling them take constant time (see Traits<Alarm>::wheel).
+    // The wheel advances at every tick, so it is not used with tickless timers.
+    // Its handlers are always deferred, so none of them runs (and possibly
+    // switches context) while the due alarms are being taken from the wheel.
+    static const bool wheel = Traits<Alarm>::wheel && !tickless && Traits<Softirq>::enabled;
+    typedef Wheel_Queue<Alarm, Tick, Queue::Element, wheel ? Traits<Alarm>::SLOTS : 1> Wheel;
+
+    // Handlers can be deferred to a Softirq, so they run with interrupts
+    // enabled once the timer's ISR returns (see Traits<Alarm>::deferred)
+    static const bool deferred = (Traits<Alarm>::deferred || wheel) && Traits<Softirq>::enabled;
+
 public:
     Alarm(const Microsecond & time, Handler * handler, unsigned int times = 1);
     ~Alarm();
@@ -53,7 +74,12 @@ public:
 private:
     static void init();
 
-    static volatile Tick & elapsed() { return _elapsed; }
+    static Tick elapsed() {
+        if(tickless)
+            return (TSC::time_stamp() - _base) * frequency() / TSC::frequency();
+        else
+            return _elapsed;
+    }
 
     static Microsecond timer_period() { return 1000000 / frequency(); }
     static Tick ticks(const Microsecond & time) { return (time + timer_period() / 2) / timer_period(); }
@@ -61,6 +87,14 @@ private:
     static void lock();
     static void unlock();
 
+    static void insert(Queue::Element * e);
+    static void remove(Queue::Element * e);
+
+    class Sleeper;
+    static void wakeup(Sleeper * sleeper);
+    static void program();
+    static void fire(Alarm * alarm);
+
     static void handler(IC::Interrupt_Id i);
 
 private:
@@ -69,10 +103,15 @@ private:
     unsigned int _times;
     Tick _ticks;
     Queue::Element _link;
+    Softirq _softirq;
 
     static Alarm_Timer * _timer;
     static volatile Tick _elapsed;
+    static volatile Tick _last;
+    static TSC::Time_Stamp _base;
     static Queue _request;
+    static Alarm * _next; // taken from _request, fires when the handler's next_tick expires
+    static Wheel _wheel;
 };
 
 
@@ -0,0 +1,140 @@
+// EPOS Arena Utility Declarations
+
+#ifndef __arena_h
+#define __arena_h
+
+#include <system.h>
+
+__BEGIN_UTIL
+
+// Arena (a.k.a. region)
+// Bump-pointer allocator for objects that die together: alloc() just advances
+// a pointer within the current chunk and reset() releases everything at once.
+// Chunks of Traits<Heaps>::ARENA_CHUNK bytes (or larger, for larger requests)
+// come from the application's heap and are kept across resets, so a reused
+// arena soon stops touching the heap. A Scope records the current position and
+// rolls the arena back to it when destroyed, thus nested scopes release their
+// allocations in LIFO order. Objects are created with placement new, as in
+// "new (arena) T(...)", and are never destroyed by the arena, so they must not
+// be deleted nor rely on their destructors. Like malloc(), allocations never
+// fail: a heap that can't provide a new chunk panics. Not synchronized.
+class Arena
+{
+private:
+    static const unsigned int ALIGN = sizeof(void *);
+
+    struct Chunk {
+        Chunk * next;
+        char * end;
+
+        char * data() { return reinterpret_cast<char *>(this + 1); }
+    };
+
+public:
+    // Allocations made during a Scope's lifetime are released at its end
+    class Scope
+    {
+    public:
+        Scope(Arena & arena): _arena(arena), _chunk(arena._chunk), _top(arena._top) {}
+        ~Scope() { _arena._chunk = _chunk; _arena._top = _top; }
+
+    private:
+        Arena & _arena;
+        Chunk * _chunk;
+        char * _top;
+    };
+
+public:
+    Arena(unsigned int chunk = Traits<Heaps>::ARENA_CHUNK): _chunk_size(chunk), _head(0), _chunk(0), _top(0) {
+        db<Heaps>(TRC) << "Arena(chunk=" << chunk << ") => " << this << endl;
+    }
+
+    ~Arena() {
+        db<Heaps>(TRC) << "~Arena(this=" << this << ")" << endl;
+
+        release();
+    }
+
+    void * alloc(unsigned int bytes, unsigned int align = ALIGN) {
+        char * addr = align_up(_top, align);
+        if(!_chunk || (addr + bytes > _chunk->end)) {
+            grow(bytes + align - 1);
+            addr = align_up(_top, align);
+        }
+        _top = addr + bytes;
+
+        return addr;
+    }
+
+    // Releases all allocations, but keeps the chunks for reuse
+    void reset() {
+        db<Heaps>(TRC) << "Arena::reset(this=" << this << ")" << endl;
+
+        _chunk = 0;
+        _top = 0;
+    }
+
+    // Releases all allocations and returns the chunks to the heap
+    void release() {
+        while(_head) {
+            Chunk * c = _head;
+            _head = c->next;
+            free(c);
+        }
+        _chunk = 0;
+        _top = 0;
+    }
+
+    // Bytes held by the arena (i.e. taken from the heap)
+    unsigned int capacity() const {
+        unsigned int bytes = 0;
+        for(Chunk * c = _head; c; c = c->next)
+            bytes += c->end - c->data();
+        return bytes;
+    }
+
+private:
+    // Moves to the next chunk, if it can hold the given number of bytes, or
+    // inserts a new chunk in its place, keeping the following ones for reuse
+    void grow(unsigned int bytes) {
+        Chunk * next = _chunk ? _chunk->next : _head;
+
+        if(!next || (static_cast<unsigned int>(next->end - next->data()) < bytes)) {
+            unsigned int size = (bytes > _chunk_size) ? bytes : _chunk_size;
+            Chunk * c = reinterpret_cast<Chunk *>(malloc(sizeof(Chunk) + size));
+            c->end = c->data() + size;
+            c->next = next;
+            if(_chunk)
+                _chunk->next = c;
+            else
+                _head = c;
+            next = c;
+        }
+
+        _chunk = next;
+        _top = next->data();
+    }
+
+    static char * align_up(char * addr, unsigned int align) {
+        return reinterpret_cast<char *>((reinterpret_cast<unsigned long>(addr) + align - 1) & ~static_cast<unsigned long>(align - 1));
+    }
+
+private:
+    unsigned int _chunk_size;
+    Chunk * _head;
+    Chunk * _chunk;
+    char * _top;
+};
+
+__END_UTIL
+
+// Placement new on arenas
+inline void * operator new(size_t bytes, EPOS::S::U::Arena & arena) {
+    return arena.alloc(bytes);
+}
+
+inline void * operator new[](size_t bytes, EPOS::S::U::Arena & arena) {
+    return arena.alloc(bytes);
+}
+
+#endif
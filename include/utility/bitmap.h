@@ -34,6 +34,19 @@ public:
         return false;
     }
 
+    bool get(unsigned int index) const {
+        return (index < BITS) && (_map[index / BPI] & (1 << (index & mask)));
+    }
+
+    // Index of the lowest bit set (or BITS if none is set)
+    // The lowest set bit is isolated with (x & -x) so a single clz finds it
+    unsigned int first() const {
+        for(unsigned int i = 0; i < SIZE; i++)
+            if(_map[i])
+                return i * BPI + (BPI - 1 - __builtin_clz(_map[i] & -_map[i]));
+        return BITS;
+    }
+
     bool full(unsigned int upto) const {
         unsigned int i;
         for(i = 0; i < upto / BPI; i++)
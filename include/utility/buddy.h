@@ -0,0 +1,171 @@
+// EPOS Buddy Allocator Utility Declarations
+
+#ifndef __buddy_h
+#define __buddy_h
+
+#include <system/config.h>
+
+__BEGIN_UTIL
+
+// Floor of the base-2 logarithm of N (0 for N <= 1)
+constexpr unsigned int buddy_log2(unsigned long n) { return (n > 1) ? 1 + buddy_log2(n >> 1) : 0; }
+
+
+// Buddy Allocator
+// Binary buddy system over the memory range [BASE, TOP], in power-of-2
+// multiples of UNIT. Every free block is aligned to its own size and sits in
+// the list of its order, so a block and its buddy (its address with the bit
+// of the order flipped) merge as soon as both are free. A bitmap marks the
+// first unit of each free block, thus telling whether a buddy is free never
+// depends on the contents of allocated memory. Lists are linked through the
+// free blocks themselves, which are accessed at OFFSET from their addresses
+// (e.g. the logical mapping of physical memory).
+// Objects have no constructor so they can be used before global constructors
+// run: being static, they start zeroed, i.e. empty.
+template<unsigned long BASE, unsigned long TOP, unsigned long UNIT, unsigned long OFFSET = 0>
+class Buddy_Allocator
+{
+public:
+    typedef unsigned long Address;
+
+private:
+    static const Address FIRST = BASE & ~(UNIT - 1);
+    static const unsigned long UNITS = (TOP - FIRST) / UNIT + 1;
+    static const Address LAST = FIRST + (UNITS - 1) * UNIT;
+    static const unsigned int ORDERS = buddy_log2(UNITS) + 1;
+    static const unsigned int BPW = sizeof(unsigned long) * 8;
+
+    struct Block {
+        Block * next;
+        Block * prev;
+        unsigned int order;
+    };
+
+public:
+    static const unsigned long MAX_BLOCK = UNIT << (ORDERS - 1);
+
+public:
+    // Blocks are naturally aligned: allocations get the address of a block of
+    // the next power-of-2 size, whose unused tail is returned right away
+    Address alloc(unsigned long bytes) {
+        if(!bytes || (bytes > MAX_BLOCK))
+            return 0;
+
+        unsigned long units = (bytes + UNIT - 1) / UNIT;
+        unsigned int order = buddy_log2(units);
+        if(units > (1UL << order))
+            order++;
+
+        unsigned long orders = _orders & (~0UL << order);
+        if(!orders)
+            return 0;
+
+        unsigned int o = __builtin_ctzl(orders);
+        Block * b = _free[o];
+        remove(b, o);
+
+        Address addr = address(b);
+        while(o > order) {
+            o--;
+            insert(addr + (UNIT << o), o);
+        }
+        if(units < (1UL << order))
+            release(addr + units * UNIT, addr + (UNIT << order));
+
+        _available -= units * UNIT;
+
+        return addr;
+    }
+
+    // Blocks obtained with alloc(), with the same size
+    void free(Address addr, unsigned long bytes) {
+        unsigned long units = (bytes + UNIT - 1) / UNIT;
+        release(addr, addr + units * UNIT);
+        _available += units * UNIT;
+    }
+
+    // Free memory regions, of which only whole units within [BASE, TOP] are used
+    void add(Address addr, unsigned long bytes) {
+        Address end = addr + bytes;
+        if(addr < FIRST)
+            addr = FIRST;
+        if(end > LAST + UNIT)
+            end = LAST + UNIT;
+
+        addr = (addr + UNIT - 1) & ~(UNIT - 1);
+        end &= ~(UNIT - 1);
+        if(addr < end) {
+            release(addr, end);
+            _available += end - addr;
+        }
+    }
+
+    unsigned long available() const { return _available; }
+    unsigned long largest() const { return _orders ? UNIT << (BPW - 1 - __builtin_clzl(_orders)) : 0; }
+
+private:
+    // Splits [from, to) into the largest aligned blocks and frees them
+    void release(Address from, Address to) {
+        while(from < to) {
+            unsigned int o = 0;
+            while((o + 1 < ORDERS) && !(from & (UNIT << o)) && (from + (UNIT << (o + 1)) <= to))
+                o++;
+            merge(from, o);
+            from += UNIT << o;
+        }
+    }
+
+    void merge(Address addr, unsigned int order) {
+        while(order + 1 < ORDERS) {
+            Address buddy = addr ^ (UNIT << order);
+            if((buddy < FIRST) || (buddy + (UNIT << order) > LAST + UNIT) || !marked(buddy) || (block(buddy)->order != order))
+                break;
+            remove(block(buddy), order);
+            addr &= ~(UNIT << order);
+            order++;
+        }
+        insert(addr, order);
+    }
+
+    void insert(Address addr, unsigned int order) {
+        Block * b = block(addr);
+        b->order = order;
+        b->prev = 0;
+        b->next = _free[order];
+        if(b->next)
+            b->next->prev = b;
+        _free[order] = b;
+        _orders |= 1UL << order;
+        mark(addr);
+    }
+
+    void remove(Block * b, unsigned int order) {
+        if(b->prev)
+            b->prev->next = b->next;
+        else
+            _free[order] = b->next;
+        if(b->next)
+            b->next->prev = b->prev;
+        if(!_free[order])
+            _orders &= ~(1UL << order);
+        unmark(address(b));
+    }
+
+    static Block * block(Address addr) { return reinterpret_cast<Block *>(addr + OFFSET); }
+    static Address address(Block * b) { return reinterpret_cast<Address>(b) - OFFSET; }
+
+    static unsigned long index(Address addr) { return (addr - FIRST) / UNIT; }
+    bool marked(Address addr) const { return _map[index(addr) / BPW] & (1UL << (index(addr) % BPW)); }
+    void mark(Address addr) { _map[index(addr) / BPW] |= 1UL << (index(addr) % BPW); }
+    void unmark(Address addr) { _map[index(addr) / BPW] &= ~(1UL << (index(addr) % BPW)); }
+
+private:
+    Block * _free[ORDERS];
+    unsigned long _orders;
+    unsigned long _available;
+    unsigned long _map[(UNITS + BPW - 1) / BPW];
+};
+
+__END_UTIL
+
+#endif
@@ -6,27 +6,37 @@
 #include <utility/debug.h>
 #include <utility/list.h>
 #include <utility/spin.h>
+#include <utility/string.h>
 
 __BEGIN_UTIL
 
 // Heap
-class Heap: private Grouping_List<char>
+class Simple_Heap: private Grouping_List<char>
 {
 public:
     using Grouping_List<char>::empty;
     using Grouping_List<char>::size;
+    using Grouping_List<char>::grouped_size;
 
-    Heap() {
+    Simple_Heap() {
         db<Init, Heaps>(TRC) << "Heap() => " << this << endl;
     }
 
-    Heap(void * addr, unsigned int bytes) {
+    Simple_Heap(void * addr, unsigned int bytes) {
         db<Init, Heaps>(TRC) << "Heap(addr=" << addr << ",bytes=" << bytes << ") => " << this << endl;
 
         free(addr, bytes);
     }
 
     void * alloc(unsigned int bytes) {
+        void * ptr = try_alloc(bytes);
+        if(!ptr && bytes)
+            out_of_memory();
+        return ptr;
+    }
+
+    // As alloc(), but returns 0 instead of panicking when no block fits
+    void * try_alloc(unsigned int bytes) {
         db<Heaps>(TRC) << "Heap::alloc(this=" << this << ",bytes=" << bytes;
 
         if(!bytes)
@@ -42,7 +52,7 @@ public:
 
         Element * e = search_decrementing(bytes);
         if(!e) {
-            out_of_memory();
+            db<Heaps>(TRC) << ") => 0" << endl;
             return 0;
         }
 
@@ -71,10 +81,1021 @@ public:
         free(addr, bytes);
     }
 
+    // Free memory, including block headers, and the largest free block
+    unsigned int available() const { return grouped_size(); }
+    unsigned int largest() {
+        unsigned int bytes = 0;
+        for(Element * e = head(); e; e = e->next())
+            if(e->size() > bytes)
+                bytes = e->size();
+        return bytes;
+    }
+
 private:
     void out_of_memory();
 };
 
+
+// TLSF Heap
+// Two-Level Segregated Fit (Masmano et al., ECRTS 2004): free blocks are kept
+// in lists indexed by a first level (power-of-2 size range) and a second level
+// (SL linear subranges of it). Bitmaps of non-empty lists lead to a good fit
+// with two bit scans and boundary tags merge neighbors, so alloc() and free()
+// take constant time. As in Simple_Heap, the word before each block holds its
+// size, so both can sit behind the same front ends.
+class TLSF_Heap
+{
+private:
+    static const unsigned int ALIGN = sizeof(void *);
+    static const unsigned int ALIGN_LOG2 = (ALIGN == 8) ? 3 : 2;
+    static const unsigned int SL_LOG2 = 4;
+    static const unsigned int SL = 1 << SL_LOG2;
+    static const unsigned int FL_SHIFT = SL_LOG2 + ALIGN_LOG2;
+    static const unsigned int FL = sizeof(unsigned int) * 8 - FL_SHIFT + 1;
+    static const unsigned int SMALL = 1 << FL_SHIFT;
+
+    // Flags
+    enum {
+        FREE      = 1 << 0,
+        PREV_FREE = 1 << 1
+    };
+
+    struct Block {
+        Block * prev;           // previous physical block (valid if PREV_FREE)
+        unsigned int flags;
+        unsigned int size;      // including the header
+        Block * next_free;      // free blocks only
+        Block * prev_free;      // free blocks only
+    };
+
+    static const unsigned int HEADER = sizeof(Block *) + 2 * sizeof(unsigned int);
+    static const unsigned int MIN_BLOCK = sizeof(Block);
+
+public:
+    TLSF_Heap() { clear(); }
+
+    TLSF_Heap(void * addr, unsigned int bytes) {
+        db<Init, Heaps>(TRC) << "TLSF_Heap(addr=" << addr << ",bytes=" << bytes << ") => " << this << endl;
+
+        clear();
+        free(addr, bytes);
+    }
+
+    bool empty() const { return !_fl_map; }
+    unsigned int size() const { return _blocks; }
+
+    // Free memory, including block headers, and the largest free block,
+    // which is in the highest non-empty list
+    unsigned int available() const { return _bytes; }
+    unsigned int largest() const {
+        if(!_fl_map)
+            return 0;
+
+        unsigned int fl = msb(_fl_map);
+        unsigned int bytes = 0;
+        for(Block * b = _free[fl][msb(_sl_map[fl])]; b; b = b->next_free)
+            if(b->size > bytes)
+                bytes = b->size;
+        return bytes;
+    }
+
+    void * alloc(unsigned int bytes) {
+        void * ptr = try_alloc(bytes);
+        if(!ptr && bytes)
+            out_of_memory();
+        return ptr;
+    }
+
+    // As alloc(), but returns 0 instead of panicking when no block fits
+    void * try_alloc(unsigned int bytes) {
+        db<Heaps>(TRC) << "TLSF_Heap::alloc(this=" << this << ",bytes=" << bytes;
+
+        if(!bytes)
+            return 0;
+
+        unsigned int size = ((bytes + ALIGN - 1) & ~(ALIGN - 1)) + HEADER;
+        if(size < MIN_BLOCK)
+            size = MIN_BLOCK;
+
+        Block * b = search(size);
+        if(!b) {
+            db<Heaps>(TRC) << ") => 0" << endl;
+            return 0;
+        }
+        remove(b);
+
+        Block * n = next(b);
+        if(b->size - size >= MIN_BLOCK) {
+            // Split the remainder off as a new free block
+            Block * r = reinterpret_cast<Block *>(reinterpret_cast<char *>(b) + size);
+            r->size = b->size - size;
+            r->flags = FREE;
+            r->prev = b;
+            n->prev = r;
+            b->size = size;
+            insert(r);
+        } else
+            n->flags &= ~PREV_FREE;
+        b->flags &= ~FREE;
+
+        void * addr = reinterpret_cast<char *>(b) + HEADER;
+
+        db<Heaps>(TRC) << ") => " << addr << endl;
+
+        return addr;
+    }
+
+    // Adds a memory region to the heap
+    void free(void * ptr, unsigned int bytes) {
+        db<Heaps>(TRC) << "TLSF_Heap::free(this=" << this << ",ptr=" << ptr << ",bytes=" << bytes << ")" << endl;
+
+        unsigned long addr = reinterpret_cast<unsigned long>(ptr);
+        unsigned long start = (addr + ALIGN - 1) & ~static_cast<unsigned long>(ALIGN - 1);
+        if(!ptr || (bytes < (start - addr) + MIN_BLOCK + HEADER))
+            return;
+        bytes = (bytes - (start - addr)) & ~(ALIGN - 1);
+
+        // The region ends with a header-only sentinel block, which is never free
+        Block * b = reinterpret_cast<Block *>(start);
+        b->size = bytes - HEADER;
+        b->flags = FREE;
+        Block * s = next(b);
+        s->size = HEADER;
+        s->flags = PREV_FREE;
+        s->prev = b;
+        insert(b);
+    }
+
+    void free(void * ptr) {
+        db<Heaps>(TRC) << "TLSF_Heap::free(this=" << this << ",ptr=" << ptr << ")" << endl;
+
+        if(!ptr)
+            return;
+
+        Block * b = reinterpret_cast<Block *>(reinterpret_cast<char *>(ptr) - HEADER);
+        b->flags |= FREE;
+
+        if(b->flags & PREV_FREE) {
+            Block * p = b->prev;
+            remove(p);
+            p->size += b->size;
+            b = p;
+        }
+
+        Block * n = next(b);
+        if(n->flags & FREE) {
+            remove(n);
+            b->size += n->size;
+            n = next(b);
+        }
+        n->prev = b;
+        n->flags |= PREV_FREE;
+
+        insert(b);
+    }
+
+private:
+    static Block * next(Block * b) { return reinterpret_cast<Block *>(reinterpret_cast<char *>(b) + b->size); }
+
+    static unsigned int msb(unsigned int x) { return sizeof(unsigned int) * 8 - 1 - __builtin_clz(x); }
+    static unsigned int lsb(unsigned int x) { return __builtin_ctz(x); }
+
+    static void mapping(unsigned int size, unsigned int * fl, unsigned int * sl) {
+        if(size < SMALL) {
+            *fl = 0;
+            *sl = size / (SMALL / SL);
+        } else {
+            unsigned int f = msb(size);
+            *sl = (size >> (f - SL_LOG2)) ^ SL;
+            *fl = f - (FL_SHIFT - 1);
+        }
+    }
+
+    // Finds a free block of at least size bytes in the first non-empty list
+    // whose blocks are all large enough (i.e. size rounded up to the next list)
+    Block * search(unsigned int size) {
+        if(size >= SMALL)
+            size += (1 << (msb(size) - SL_LOG2)) - 1;
+
+        unsigned int fl, sl;
+        mapping(size, &fl, &sl);
+        if(fl >= FL)
+            return 0;
+
+        unsigned int sl_map = _sl_map[fl] & (~0U << sl);
+        if(!sl_map) {
+            unsigned int fl_map = (fl + 1 < FL) ? _fl_map & (~0U << (fl + 1)) : 0;
+            if(!fl_map)
+                return 0;
+            fl = lsb(fl_map);
+            sl_map = _sl_map[fl];
+        }
+
+        return _free[fl][lsb(sl_map)];
+    }
+
+    void insert(Block * b) {
+        unsigned int fl, sl;
+        mapping(b->size, &fl, &sl);
+
+        b->prev_free = 0;
+        b->next_free = _free[fl][sl];
+        if(b->next_free)
+            b->next_free->prev_free = b;
+        _free[fl][sl] = b;
+        _fl_map |= 1U << fl;
+        _sl_map[fl] |= 1U << sl;
+        _blocks++;
+        _bytes += b->size;
+    }
+
+    void remove(Block * b) {
+        unsigned int fl, sl;
+        mapping(b->size, &fl, &sl);
+
+        if(b->next_free)
+            b->next_free->prev_free = b->prev_free;
+        if(b->prev_free)
+            b->prev_free->next_free = b->next_free;
+        else {
+            _free[fl][sl] = b->next_free;
+            if(!_free[fl][sl]) {
+                _sl_map[fl] &= ~(1U << sl);
+                if(!_sl_map[fl])
+                    _fl_map &= ~(1U << fl);
+            }
+        }
+        _blocks--;
+        _bytes -= b->size;
+    }
+
+    void clear() {
+        _blocks = 0;
+        _bytes = 0;
+        _fl_map = 0;
+        for(unsigned int i = 0; i < FL; i++) {
+            _sl_map[i] = 0;
+            for(unsigned int j = 0; j < SL; j++)
+                _free[i][j] = 0;
+        }
+    }
+
+    void out_of_memory();
+
+private:
+    unsigned int _blocks;
+    unsigned int _bytes;
+    unsigned int _fl_map;
+    unsigned int _sl_map[FL];
+    Block * _free[FL][SL];
+};
+
+
+// Slab Heap
+// Small blocks are served from segregated free lists, one per power-of-2 size
+// class from MIN to MAX bytes, which are refilled with slabs carved from the
+// underlying heap T. Larger blocks go straight to T. Blocks carry a header
+// word, just like those of T, but holding the negated size requested for slab
+// objects, so free() can route them. Slabs are never returned to T. Slabs
+// take at most 1/CLASSES of the heap, so small heaps (e.g. a few KB on
+// microcontrollers) aren't drained by the first small allocation, and shrink
+// to what still fits as the heap fills up.
+template<typename T>
+class Slab_Heap: public T
+{
+private:
+    static const unsigned int HEADER = sizeof(void *); // keeps objects aligned
+    static const unsigned int SLAB_SIZE = Traits<Heaps>::SLAB_SIZE;
+
+    typedef TSC::Time_Stamp Time_Stamp;
+
+public:
+    static const unsigned int CLASSES = 8;
+    static const unsigned int MIN = 16;
+    static const unsigned int MAX = MIN << (CLASSES - 1);
+
+    // Operation latency, in TSC ticks
+    struct Latency {
+        void sample(const Time_Stamp & t) {
+            if(!count || (t < min))
+                min = t;
+            if(t > max)
+                max = t;
+            total += t;
+            count++;
+        }
+
+        friend OStream & operator<<(OStream & os, const Latency & l) {
+            os << "{n=" << l.count << ",min=" << l.min << ",max=" << l.max << ",avg=" << (l.count ? l.total / l.count : 0) << "}";
+            return os;
+        }
+
+        Time_Stamp min;
+        Time_Stamp max;
+        Time_Stamp total;
+        unsigned long count;
+    };
+
+    // Collected only if Traits<Heaps>::statistics
+    struct Statistics {
+        friend OStream & operator<<(OStream & os, const Statistics & s) {
+            os << "{small:";
+            for(unsigned int i = 0; i < CLASSES; i++)
+                os << " " << (MIN << i) << "={slabs=" << s.slabs[i] << ",used=" << s.used[i] << ",free=" << s.free[i] << "}";
+            os << ",requested=" << s.requested << ",granted=" << s.granted
+               << ",large=" << s.large << ",alloc=" << s.alloc << ",free=" << s.release << "}";
+            return os;
+        }
+
+        unsigned int slabs[CLASSES];    // slabs carved from the underlying heap
+        unsigned int used[CLASSES];     // objects allocated
+        unsigned int free[CLASSES];     // objects in free lists (i.e. slack)
+        unsigned long requested;        // bytes requested for allocated objects
+        unsigned long granted;          // bytes of their classes (internal fragmentation = granted - requested)
+        unsigned int large;             // blocks allocated from the underlying heap
+        Latency alloc;
+        Latency release;
+    };
+
+public:
+    Slab_Heap(): _slab_size(SLAB_SIZE) { clear(); }
+    Slab_Heap(void * addr, unsigned int bytes): T(addr, bytes), _slab_size((bytes / CLASSES < SLAB_SIZE) ? bytes / CLASSES : SLAB_SIZE) { clear(); }
+
+    void * alloc(unsigned int bytes) { return allocate(bytes, true); }
+
+    // As alloc(), but returns 0 instead of panicking when T runs out of memory
+    void * try_alloc(unsigned int bytes) { return allocate(bytes, false); }
+
+    void free(void * ptr, unsigned int bytes) { T::free(ptr, bytes); }
+
+    void free(void * ptr) {
+        if(!ptr)
+            return;
+
+        Time_Stamp start = Traits<Heaps>::statistics ? TSC::time_stamp() : 0;
+
+        int t = tag(ptr);
+        if(t > 0) {
+            T::free(ptr);
+            if(Traits<Heaps>::statistics)
+                _statistics.large--;
+        } else {
+            db<Heaps>(TRC) << "Slab_Heap::free(this=" << this << ",ptr=" << ptr << ")" << endl;
+
+            unsigned int bytes = -t;
+            unsigned int c = size_class(bytes);
+            Object * o = reinterpret_cast<Object *>(ptr);
+            o->next = _free[c];
+            _free[c] = o;
+
+            if(Traits<Heaps>::statistics) {
+                _statistics.used[c]--;
+                _statistics.free[c]++;
+                _statistics.requested -= bytes;
+                _statistics.granted -= MIN << c;
+            }
+        }
+
+        if(Traits<Heaps>::statistics)
+            _statistics.release.sample(TSC::time_stamp() - start);
+    }
+
+    const Statistics & statistics() const { return _statistics; }
+
+protected:
+    static unsigned int size_class(unsigned int bytes) {
+        unsigned int c = 0;
+        while((MIN << c) < bytes)
+            c++;
+        return c;
+    }
+
+    // Header of blocks, negative for slab objects (i.e. -requested bytes)
+    static int & tag(void * ptr) { return reinterpret_cast<int *>(ptr)[-1]; }
+
+private:
+    struct Object {
+        Object * next;
+    };
+
+    void * allocate(unsigned int bytes, bool panic) {
+        Time_Stamp start = Traits<Heaps>::statistics ? TSC::time_stamp() : 0;
+
+        void * ptr;
+        if(!bytes || (bytes > MAX)) {
+            ptr = panic ? T::alloc(bytes) : T::try_alloc(bytes);
+            if(Traits<Heaps>::statistics && ptr)
+                _statistics.large++;
+        } else {
+            unsigned int c = size_class(bytes);
+            if(!_free[c])
+                refill(c, panic);
+
+            Object * o = _free[c];
+            if(!o)
+                return 0;
+            _free[c] = o->next;
+            tag(o) = -int(bytes);
+            ptr = o;
+
+            if(Traits<Heaps>::statistics) {
+                _statistics.used[c]++;
+                _statistics.free[c]--;
+                _statistics.requested += bytes;
+                _statistics.granted += MIN << c;
+            }
+
+            db<Heaps>(TRC) << "Slab_Heap::alloc(this=" << this << ",bytes=" << bytes << ") => " << ptr << endl;
+        }
+
+        if(Traits<Heaps>::statistics)
+            _statistics.alloc.sample(TSC::time_stamp() - start);
+
+        return ptr;
+    }
+
+    // Carves a new slab for class c from the underlying heap, halving it
+    // while it doesn't fit. Only a single object runs T out of memory.
+    void refill(unsigned int c, bool panic) {
+        unsigned int stride = HEADER + (MIN << c);
+        unsigned int n = (_slab_size / stride) ? (_slab_size / stride) : 1;
+
+        char * slab = 0;
+        for(; n > 1; n /= 2)
+            if((slab = reinterpret_cast<char *>(T::try_alloc(n * stride))))
+                break;
+        if(!slab) {
+            slab = reinterpret_cast<char *>(panic ? T::alloc(stride) : T::try_alloc(stride));
+            if(!slab)
+                return;
+        }
+
+        db<Heaps>(TRC) << "Slab_Heap::refill(this=" << this << ",class=" << (MIN << c) << ") => {slab=" << reinterpret_cast<void *>(slab) << ",n=" << n << "}" << endl;
+
+        for(unsigned int i = n; i > 0; i--) {
+            Object * o = reinterpret_cast<Object *>(slab + (i - 1) * stride + HEADER);
+            o->next = _free[c];
+            _free[c] = o;
+        }
+
+        if(Traits<Heaps>::statistics) {
+            _statistics.slabs[c]++;
+            _statistics.free[c] += n;
+        }
+    }
+
+    void clear() {
+        for(unsigned int i = 0; i < CLASSES; i++)
+            _free[i] = 0;
+        memset(&_statistics, 0, sizeof(Statistics));
+    }
+
+private:
+    unsigned int _slab_size;
+    Object * _free[CLASSES];
+    Statistics _statistics;
+};
+
+
+// Magazine Heap
+// Multicore front end for Slab_Heap: each CPU caches up to SIZE objects of
+// each size class in a magazine, so most allocations and releases touch
+// neither the heap lock nor memory shared with other CPUs. Magazines are
+// refilled from and flushed to the shared heap in batches of half their size
+// under a spin lock, which also serializes blocks larger than T::MAX.
+template<typename T>
+class Magazine_Heap: public T
+{
+private:
+    static const unsigned int CPUS = Traits<Build>::CPUS;
+    static const unsigned int SIZE = Traits<Heaps>::MAGAZINE_SIZE;
+    static const unsigned int BATCH = (SIZE > 1) ? SIZE / 2 : 1;
+
+    using T::CLASSES;
+    using T::MIN;
+    using T::MAX;
+    using T::size_class;
+    using T::tag;
+
+    struct Magazine {
+        unsigned int count;
+        void * object[SIZE];
+    };
+
+public:
+    Magazine_Heap() { clear(); }
+    Magazine_Heap(void * addr, unsigned int bytes): T(addr, bytes) { clear(); }
+
+    void * alloc(unsigned int bytes) { return allocate(bytes, true); }
+
+    // As alloc(), but returns 0 instead of panicking when T runs out of memory
+    void * try_alloc(unsigned int bytes) { return allocate(bytes, false); }
+
+    void free(void * ptr) {
+        if(!ptr)
+            return;
+
+        bool disabled = enter();
+
+        int t = tag(ptr);
+        if(t > 0) {
+            _lock.acquire();
+            T::free(ptr);
+            _lock.release();
+        } else {
+            unsigned int c = size_class(-t);
+            Magazine & m = _magazine[CPU::id()][c];
+            if(m.count == SIZE)
+                flush(m, c);
+            m.object[m.count++] = ptr;
+        }
+
+        leave(disabled);
+    }
+
+    void free(void * ptr, unsigned int bytes) {
+        bool disabled = enter();
+        _lock.acquire();
+        T::free(ptr, bytes);
+        _lock.release();
+        leave(disabled);
+    }
+
+    unsigned int available() {
+        bool disabled = enter();
+        _lock.acquire();
+        unsigned int bytes = T::available();
+        _lock.release();
+        leave(disabled);
+        return bytes;
+    }
+
+    unsigned int largest() {
+        bool disabled = enter();
+        _lock.acquire();
+        unsigned int bytes = T::largest();
+        _lock.release();
+        leave(disabled);
+        return bytes;
+    }
+
+private:
+    void * allocate(unsigned int bytes, bool panic) {
+        bool disabled = enter();
+
+        void * ptr;
+        if(!bytes || (bytes > MAX)) {
+            _lock.acquire();
+            ptr = panic ? T::alloc(bytes) : T::try_alloc(bytes);
+            _lock.release();
+        } else {
+            unsigned int c = size_class(bytes);
+            Magazine & m = _magazine[CPU::id()][c];
+            if(!m.count)
+                refill(m, c, panic);
+            ptr = m.count ? m.object[--m.count] : 0;
+            if(ptr)
+                tag(ptr) = -int(bytes);
+        }
+
+        leave(disabled);
+
+        return ptr;
+    }
+
+    // Magazines belong to the CPU, so the running thread must not migrate
+    bool enter() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        return disabled;
+    }
+
+    void leave(bool disabled) {
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+    void refill(Magazine & m, unsigned int c, bool panic) {
+        _lock.acquire();
+        for(void * ptr; (m.count < BATCH) && (ptr = (panic ? T::alloc(MIN << c) : T::try_alloc(MIN << c))); )
+            m.object[m.count++] = ptr;
+        _lock.release();
+    }
+
+    // Objects are flushed with the size of their class, which T accounted
+    // for when they were first taken from it
+    void flush(Magazine & m, unsigned int c) {
+        _lock.acquire();
+        for(unsigned int i = 0; i < BATCH; i++) {
+            void * ptr = m.object[--m.count];
+            tag(ptr) = -int(MIN << c);
+            T::free(ptr);
+        }
+        _lock.release();
+    }
+
+    void clear() {
+        for(unsigned int i = 0; i < CPUS; i++)
+            for(unsigned int j = 0; j < CLASSES; j++)
+                _magazine[i][j].count = 0;
+    }
+
+private:
+    Magazine _magazine[CPUS][CLASSES];
+    Simple_Spin _lock;
+};
+
+
+// Block Cache
+// Keeps up to N released blocks for allocations of the same size, sparing
+// the heap the corresponding free() and alloc(). Not synchronized.
+template<unsigned int N>
+class Block_Cache
+{
+public:
+    Block_Cache(): _count(0) {}
+
+    // Returns a block of exactly the given size, or 0 if none is cached
+    void * get(unsigned int bytes) {
+        for(unsigned int i = 0; i < _count; i++)
+            if(_block[i].size == bytes) {
+                void * addr = _block[i].addr;
+                _block[i] = _block[--_count];
+                return addr;
+            }
+        return 0;
+    }
+
+    // Returns any cached block (e.g. to give it back to the heap), or 0 if empty
+    void * remove() { return _count ? _block[--_count].addr : 0; }
+
+    // Returns false if the cache is full, in which case the block must be freed
+    bool put(void * addr, unsigned int bytes) {
+        if(_count == N)
+            return false;
+        _block[_count].addr = addr;
+        _block[_count].size = bytes;
+        _count++;
+        return true;
+    }
+
+private:
+    struct Block {
+        void * addr;
+        unsigned int size;
+    };
+
+    unsigned int _count;
+    Block _block[N];
+};
+
+
+// Wrapper for non-atomic heaps
+template<typename T, bool atomic>
+class Heap_Wrapper: public T
+{
+public:
+    Heap_Wrapper() {}
+    Heap_Wrapper(void * addr, unsigned int bytes): T(addr, bytes) {}
+};
+
+
+// Wrapper for atomic heaps
+// Heaps shared by several CPUs are serialized by a spin lock, with interrupts
+// disabled on the current CPU to avoid deadlocks with interrupt handlers
+template<typename T>
+class Heap_Wrapper<T, true>: public T
+{
+public:
+    Heap_Wrapper() {}
+    Heap_Wrapper(void * addr, unsigned int bytes): T(addr, bytes) {}
+
+    void * alloc(unsigned int bytes) {
+        bool disabled = enter();
+        void * tmp = T::alloc(bytes);
+        leave(disabled);
+        return tmp;
+    }
+
+    void * try_alloc(unsigned int bytes) {
+        bool disabled = enter();
+        void * tmp = T::try_alloc(bytes);
+        leave(disabled);
+        return tmp;
+    }
+
+    void free(void * ptr) {
+        bool disabled = enter();
+        T::free(ptr);
+        leave(disabled);
+    }
+
+    void free(void * ptr, unsigned int bytes) {
+        bool disabled = enter();
+        T::free(ptr, bytes);
+        leave(disabled);
+    }
+
+    unsigned int available() {
+        bool disabled = enter();
+        unsigned int bytes = T::available();
+        leave(disabled);
+        return bytes;
+    }
+
+    unsigned int largest() {
+        bool disabled = enter();
+        unsigned int bytes = T::largest();
+        leave(disabled);
+        return bytes;
+    }
+
+private:
+    bool enter() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        _lock.acquire();
+        return disabled;
+    }
+
+    void leave(bool disabled) {
+        _lock.release();
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+private:
+    Simple_Spin _lock;
+};
+
+
+// Wrapper for atomic slab heaps, which are cached per CPU
+template<typename T>
+class Heap_Wrapper<Slab_Heap<T>, true>: public Magazine_Heap<Slab_Heap<T>>
+{
+public:
+    Heap_Wrapper() {}
+    Heap_Wrapper(void * addr, unsigned int bytes): Magazine_Heap<Slab_Heap<T>>(addr, bytes) {}
+};
+
+
+// Heap Profile
+// Heap usage as accounted by Heap_Profiler, printable over OStream to size
+// heaps from data rather than guesses. Sites beyond the first SITES that
+// allocate from a heap are accounted together.
+struct Heap_Profile
+{
+    static const unsigned int BUCKETS = 16;
+    static const unsigned int MIN = 8; // bucket i holds blocks of up to MIN << i bytes, the last one any larger
+    static const unsigned int SITES = Traits<Heaps>::PROFILE_SITES;
+
+    struct Site {
+        const void * ip;                // return address of the allocating function
+        unsigned int allocs;
+        unsigned int live;
+        unsigned long bytes;            // live
+    };
+
+    friend OStream & operator<<(OStream & os, const Heap_Profile & p) {
+        os << "{capacity=" << p.capacity << ",live=" << p.live << ",peak=" << p.peak
+           << ",free=" << p.available << ",largest=" << p.largest << ",fragmentation=" << p.fragmentation() << "%,buckets:";
+        for(unsigned int i = 0; i < BUCKETS; i++)
+            if(p.allocs[i]) {
+                if(i < BUCKETS - 1)
+                    os << " <=" << (MIN << i);
+                else
+                    os << " >" << (MIN << (i - 1));
+                os << "={allocs=" << p.allocs[i] << ",live=" << p.blocks[i] << "}";
+            }
+        os << ",sites:";
+        for(unsigned int i = 0; i <= SITES; i++)
+            if(p.sites[i].allocs) {
+                if(i < SITES)
+                    os << " " << p.sites[i].ip;
+                else
+                    os << " others";
+                os << "={allocs=" << p.sites[i].allocs << ",live=" << p.sites[i].live << ",bytes=" << p.sites[i].bytes << "}";
+            }
+        os << "}";
+        return os;
+    }
+
+    // Share of the free memory outside of the largest free block, in percent
+    unsigned int fragmentation() const {
+        return available ? static_cast<unsigned long long>(available - largest) * 100 / available : 0;
+    }
+
+    unsigned long capacity;             // bytes given to the heap
+    unsigned long live;                 // bytes requested for blocks not released yet
+    unsigned long peak;                 // maximum of live so far
+    unsigned long available;            // free bytes, including headers (when the profile was taken)
+    unsigned long largest;              // largest free block (idem)
+    unsigned int allocs[BUCKETS];
+    unsigned int blocks[BUCKETS];       // live
+    Site sites[SITES + 1];              // the last one for sites that found the table full
+};
+
+
+// Heap Profiler
+// Opt-in instrumentation (Traits<Heaps>::profiled) that keeps live and peak
+// bytes, allocation counts per power-of-2 size bucket and per call site and,
+// whenever the profile is taken, the free memory of T and its largest free
+// block. Blocks carry an extra header with their requested size and site,
+// which may move small objects up a slab class.
+template<typename T, bool profiled>
+class Heap_Profiler: public T
+{
+public:
+    Heap_Profiler() {}
+    Heap_Profiler(void * addr, unsigned int bytes): T(addr, bytes) {}
+
+    // Nothing is accounted without Traits<Heaps>::profiled
+    const Heap_Profile & profile() {
+        static const Heap_Profile empty = {};
+        return empty;
+    }
+};
+
+template<typename T>
+class Heap_Profiler<T, true>: public T
+{
+private:
+    static const unsigned int BUCKETS = Heap_Profile::BUCKETS;
+    static const unsigned int MIN = Heap_Profile::MIN;
+    static const unsigned int SITES = Heap_Profile::SITES;
+
+    struct Header {
+        unsigned int bytes;
+        unsigned int site;
+    };
+
+public:
+    Heap_Profiler() { clear(); }
+    Heap_Profiler(void * addr, unsigned int bytes): T(addr, bytes) { clear(); _profile.capacity = bytes; }
+
+    // Not inlined, so the return address is that of the allocating function
+    void * alloc(unsigned int bytes) __attribute__((noinline)) {
+        if(!bytes)
+            return 0;
+        return account(reinterpret_cast<Header *>(T::alloc(bytes + sizeof(Header))), bytes, __builtin_return_address(0));
+    }
+
+    void * try_alloc(unsigned int bytes) __attribute__((noinline)) {
+        if(!bytes)
+            return 0;
+        return account(reinterpret_cast<Header *>(T::try_alloc(bytes + sizeof(Header))), bytes, __builtin_return_address(0));
+    }
+
+    void free(void * ptr) {
+        if(!ptr)
+            return;
+
+        Header * h = reinterpret_cast<Header *>(ptr) - 1;
+
+        bool disabled = enter();
+        _profile.live -= h->bytes;
+        _profile.blocks[bucket(h->bytes)]--;
+        _profile.sites[h->site].live--;
+        _profile.sites[h->site].bytes -= h->bytes;
+        leave(disabled);
+
+        T::free(h);
+    }
+
+    void free(void * ptr, unsigned int bytes) {
+        T::free(ptr, bytes);
+
+        bool disabled = enter();
+        _profile.capacity += bytes;
+        leave(disabled);
+    }
+
+    const Heap_Profile & profile() {
+        unsigned long available = T::available();
+        unsigned long largest = T::largest();
+
+        bool disabled = enter();
+        _profile.available = available;
+        _profile.largest = largest;
+        leave(disabled);
+
+        return _profile;
+    }
+
+private:
+    static unsigned int bucket(unsigned int bytes) {
+        unsigned int b = 0;
+        while((b < BUCKETS - 1) && ((MIN << b) < bytes))
+            b++;
+        return b;
+    }
+
+    // Accounts for a block of T (if any) holding the given bytes for site ip
+    void * account(Header * h, unsigned int bytes, const void * ip) {
+        if(!h)
+            return 0;
+
+        bool disabled = enter();
+        unsigned int s = site(ip);
+        unsigned int b = bucket(bytes);
+        h->bytes = bytes;
+        h->site = s;
+        _profile.live += bytes;
+        if(_profile.live > _profile.peak)
+            _profile.peak = _profile.live;
+        _profile.allocs[b]++;
+        _profile.blocks[b]++;
+        _profile.sites[s].allocs++;
+        _profile.sites[s].live++;
+        _profile.sites[s].bytes += bytes;
+        leave(disabled);
+
+        return h + 1;
+    }
+
+    // Open addressing on the return address, with linear probing
+    unsigned int site(const void * ip) {
+        unsigned int h = (reinterpret_cast<unsigned long>(ip) >> 2) % SITES;
+        for(unsigned int i = 0; i < SITES; i++, h = (h + 1) % SITES) {
+            if(_profile.sites[h].ip == ip)
+                return h;
+            if(!_profile.sites[h].ip) {
+                _profile.sites[h].ip = ip;
+                return h;
+            }
+        }
+        return SITES;
+    }
+
+    // Profiles are shared by all CPUs and updated outside of the locks of T
+    bool enter() {
+        bool disabled = CPU::int_disabled();
+        CPU::int_disable();
+        _lock.acquire();
+        return disabled;
+    }
+
+    void leave(bool disabled) {
+        _lock.release();
+        if(!disabled)
+            CPU::int_enable();
+    }
+
+    void clear() { memset(&_profile, 0, sizeof(Heap_Profile)); }
+
+private:
+    Heap_Profile _profile;
+    Simple_Spin _lock;
+};
+
+
+// Heap used by kmalloc() and malloc(), as configured by Traits<Heaps>: a
+// first-fit or a TLSF backend, optionally behind a slab front end for small
+// blocks, which is cached per CPU on multicores (see Heap_Wrapper), and
+// optionally profiled (see Heap_Profiler)
+// The system's and the application's heaps are always distinct (and so are
+// those for new (SCRATCHPAD) and new (UNCACHED), if any), so each block is
+// tagged with the heap it came from and free() on any heap, thus delete,
+// returns it to its owner
+class Heap: public Heap_Profiler<Heap_Wrapper<IF<Traits<Heaps>::slab, Slab_Heap<IF<Traits<Heaps>::tlsf, TLSF_Heap, Simple_Heap>::Result>, IF<Traits<Heaps>::tlsf, TLSF_Heap, Simple_Heap>::Result>::Result, Traits<System>::multicore>, Traits<Heaps>::profiled>
+{
+private:
+    typedef IF<Traits<Heaps>::tlsf, TLSF_Heap, Simple_Heap>::Result Backend;
+    typedef Heap_Profiler<Heap_Wrapper<IF<Traits<Heaps>::slab, Slab_Heap<Backend>, Backend>::Result, Traits<System>::multicore>, Traits<Heaps>::profiled> Base;
+
+public:
+    Heap() {}
+    Heap(void * addr, unsigned int bytes): Base(addr, bytes) {}
+
+    void * alloc(unsigned int bytes) {
+        Heap ** tag = reinterpret_cast<Heap **>(Base::alloc(bytes + sizeof(Heap *)));
+        if(!tag)
+            return 0;
+        *tag = this;
+        return tag + 1;
+    }
+
+    // As alloc(), but returns 0 instead of panicking when the heap is exhausted
+    void * try_alloc(unsigned int bytes) {
+        Heap ** tag = reinterpret_cast<Heap **>(Base::try_alloc(bytes + sizeof(Heap *)));
+        if(!tag)
+            return 0;
+        *tag = this;
+        return tag + 1;
+    }
+
+    void free(void * ptr) {
+        if(ptr)
+            owner(ptr)->Base::free(reinterpret_cast<Heap **>(ptr) - 1);
+    }
+
+    // Gives the heap a region of memory (untagged, since it isn't a block)
+    void free(void * ptr, unsigned int bytes) { Base::free(ptr, bytes); }
+
+    // Heap a block was allocated from
+    static Heap * owner(void * ptr) { return *(reinterpret_cast<Heap **>(ptr) - 1); }
+};
+
 __END_UTIL
 
 #endif
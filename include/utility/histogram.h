@@ -0,0 +1,54 @@
+// EPOS Histogram Utility Declarations
+
+#ifndef __histogram_h
+#define __histogram_h
+
+#include <system/config.h>
+
+__BEGIN_UTIL
+
+// Histogram with power-of-2 buckets
+// Bucket 0 counts zeroes and bucket b counts samples in [2^(b-1), 2^b), but
+// the last one, which takes everything from 2^(BUCKETS-2) on. Objects have no
+// constructor so they can be used before global constructors run: being
+// static, they start zeroed, i.e. empty.
+template<unsigned int BUCKETS>
+class Log2_Histogram
+{
+public:
+    typedef unsigned long Value;
+
+public:
+    void sample(const Value & v) {
+        unsigned int b = v ? sizeof(Value) * 8 - __builtin_clzl(v) : 0;
+        _counts[(b < BUCKETS) ? b : BUCKETS - 1]++;
+        _samples++;
+        if(v > _max)
+            _max = v;
+    }
+
+    void reset() {
+        for(unsigned int b = 0; b < BUCKETS; b++)
+            _counts[b] = 0;
+        _samples = 0;
+        _max = 0;
+    }
+
+    unsigned long operator[](unsigned int b) const { return _counts[b]; }
+    unsigned long samples() const { return _samples; }
+    Value max() const { return _max; }
+
+    // Smallest value counted in bucket b
+    static Value floor(unsigned int b) { return b ? Value(1) << (b - 1) : 0; }
+
+    static unsigned int buckets() { return BUCKETS; }
+
+private:
+    unsigned long _counts[BUCKETS];
+    unsigned long _samples;
+    Value _max;
+};
+
+__END_UTIL
+
+#endif
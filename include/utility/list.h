@@ -4,6 +4,7 @@
 #define __list_h
 
 #include <system/config.h>
+#include <utility/bitmap.h>
 
 __BEGIN_UTIL
 
@@ -995,6 +996,236 @@ template<typename T,
 class Relative_List: public Ordered_List<T, R, El, true> {};
 
 
+// Doubly-Linked, Multilevel List
+// Elements are kept in one FIFO list per level, the level being the element's
+// rank (0 is the most urgent level). A bitmap of non-empty levels makes
+// insert, remove and head lookup constant-time operations, regardless of the
+// number of elements. Ranks must lay in [0, L) and must not be changed while
+// an element is in the list (remove it, change the rank, then insert again).
+template<typename T,
+          typename R = List_Element_Rank,
+          typename El = List_Elements::Doubly_Linked_Ordered<T, R>,
+          unsigned int L = 32>
+class Multilevel_List
+{
+private:
+    typedef List<T, El> Level;
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef typename Level::Iterator Iterator;
+
+    static const unsigned int LEVELS = L;
+
+public:
+    Multilevel_List(): _size(0) {}
+
+    bool empty() const { return (_size == 0); }
+    unsigned int size() const { return _size; }
+    unsigned int size(unsigned int level) const { return _level[level].size(); }
+
+    Element * head() { return empty() ? 0 : _level[_map.first()].head(); }
+
+    Iterator begin(unsigned int level) { return _level[level].begin(); }
+    Iterator end() { return Iterator(0); }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Multilevel_List::insert(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        unsigned int l = level(e);
+        _level[l].insert_tail(e);
+        _map.set(l);
+        _size++;
+    }
+
+    Element * remove() {
+        db<Lists>(TRC) << "Multilevel_List::remove()" << endl;
+
+        if(empty())
+            return 0;
+
+        unsigned int l = _map.first();
+        Element * e = _level[l].remove_head();
+        if(_level[l].empty())
+            _map.reset(l);
+        _size--;
+
+        return e;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Multilevel_List::remove(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        unsigned int l = level(e);
+        _level[l].remove(e);
+        if(_level[l].empty())
+            _map.reset(l);
+        _size--;
+
+        return e;
+    }
+
+    Element * remove(const Object_Type * obj) {
+        db<Lists>(TRC) << "Multilevel_List::remove(o=" << obj << ")" << endl;
+
+        Element * e = search(obj);
+        if(e)
+            return remove(e);
+        return 0;
+    }
+
+    Element * search(const Object_Type * obj) {
+        Element * e = 0;
+        for(unsigned int l = 0; !e && (l < L); l++)
+            if(_map.get(l))
+                e = _level[l].search(obj);
+        return e;
+    }
+
+private:
+    static unsigned int level(const Element * e) {
+        unsigned int l = int(e->rank());
+        return (l < L) ? l : L - 1;
+    }
+
+private:
+    unsigned int _size;
+    Bitmap<L> _map;
+    Level _level[L];
+};
+
+
+// Doubly-Linked, Hashed Timing Wheel
+// Elements are ranked by absolute expiration time and hashed by it into one
+// of S slots (i.e. rank modulo S). Time advances one step at a time (see
+// advance()), moving the elements of the current slot that have expired to a
+// FIFO of due elements, from which remove() takes them. Insertions and
+// removals take constant time, while each step only visits the elements of
+// one slot, which are a fraction of S of all elements when they are spread.
+template<typename T,
+          typename R = List_Element_Rank,
+          typename El = List_Elements::Doubly_Linked_Ordered<T, R>,
+          unsigned int S = 256>
+class Wheel_List
+{
+private:
+    typedef List<T, El> Slot;
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef typename Slot::Iterator Iterator;
+
+    static const unsigned int SLOTS = S;
+
+public:
+    Wheel_List(): _size(0), _now(0) {}
+
+    bool empty() const { return (_size == 0); }
+    unsigned int size() const { return _size; }
+
+    const Rank_Type & now() const { return _now; }
+
+    // Due elements, in the order they have expired
+    Element * head() { return _due.head(); }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Wheel_List::insert(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        slot(e).insert_tail(e);
+        _size++;
+    }
+
+    Element * remove() {
+        db<Lists>(TRC) << "Wheel_List::remove()" << endl;
+
+        Element * e = _due.remove_head();
+        if(e)
+            unlink(e);
+        return e;
+    }
+
+    // Elements that are not in the list are ignored (i.e. 0 is returned).
+    // An element's rank determines its slot, so it is unlinked in constant time.
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Wheel_List::remove(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        Slot & l = slot(e);
+        if(!linked(l, e))
+            return 0;
+        l.remove(e);
+        unlink(e);
+
+        return e;
+    }
+
+    Element * remove(const Object_Type * obj) {
+        db<Lists>(TRC) << "Wheel_List::remove(o=" << obj << ")" << endl;
+
+        Element * e = search(obj);
+        if(e)
+            return remove(e);
+        return 0;
+    }
+
+    Element * search(const Object_Type * obj) {
+        Element * e = _due.search(obj);
+        for(unsigned int i = 0; !e && (i < S); i++)
+            e = _slot[i].search(obj);
+        return e;
+    }
+
+    // Advances time by one step, returning the number of due elements
+    unsigned int advance() {
+        _now++;
+
+        Slot & l = _slot[index(_now)];
+        for(Element * e = l.head(), * next; e; e = next) {
+            next = e->next();
+            if(expired(e)) {
+                l.remove(e);
+                _due.insert_tail(e);
+            }
+        }
+
+        return _due.size();
+    }
+
+private:
+    bool expired(const Element * e) const { return (int(e->rank() - _now) <= 0); }
+
+    static unsigned int index(const Rank_Type & r) { return static_cast<unsigned int>(r) % S; }
+
+    Slot & slot(const Element * e) { return expired(e) ? _due : _slot[index(e->rank())]; }
+
+    // List::remove() leaves the links of removed elements untouched, so they
+    // are cleared here and membership is checked against the neighbor's link
+    static bool linked(Slot & l, const Element * e) { return e->prev() ? (e->prev()->next() == e) : (l.head() == e); }
+    void unlink(Element * e) { e->prev(0); e->next(0); _size--; }
+
+private:
+    unsigned int _size;
+    Rank_Type _now;
+    Slot _due;
+    Slot _slot[S];
+};
+
+
 // Doubly-Linked, Scheduling List
 // Objects subject to scheduling must export a type "Criterion" compatible
 // with those available at scheduler.h .
@@ -1097,6 +1328,133 @@ public:
         return _chosen;
     }
 
+    // Single-queue lists have nothing to steal (see Scheduling_Multilist)
+    Element * steal() { return 0; }
+
+    // First element, in scheduling order, allowed to run on the given queue
+    Element * search_affine(unsigned int queue) {
+        Element * e = head();
+        for(; e && !e->rank().affine(queue); e = e->next());
+        return e;
+    }
+
+private:
+    using Base::remove;
+    void chosen(Element * e) { _chosen = e; }
+
+private:
+    Element * volatile _chosen;
+};
+
+
+// Multilevel Scheduling List
+// Same semantics as Scheduling_List (the chosen element is kept outside the
+// list), but with the remaining elements in a Multilevel_List, so choosing is
+// a constant-time operation. Criteria using it must export LEVELS and rank
+// objects with small integers in [0, LEVELS).
+template<typename T,
+          typename R = typename T::Criterion,
+          typename El = List_Elements::Doubly_Linked_Scheduling<T, R>,
+          unsigned int L = R::LEVELS>
+class Multilevel_Scheduling_List: private Multilevel_List<T, R, El, L>
+{
+    template<typename FT, typename FR, typename FEl, typename FL, unsigned int FQ>
+    friend class Scheduling_Multilist;          // for chosen() and remove()
+
+private:
+    typedef Multilevel_List<T, R, El, L> Base;
+
+public:
+    typedef T Object_Type;
+    typedef R Rank_Type;
+    typedef El Element;
+    typedef typename Base::Iterator Iterator;
+
+public:
+    Multilevel_Scheduling_List(): _chosen(0) {}
+
+    using Base::empty;
+    using Base::size;
+    using Base::head;
+    using Base::begin;
+    using Base::end;
+
+    Element * volatile & chosen() { return _chosen; }
+
+    void insert(Element * e) {
+        db<Lists>(TRC) << "Multilevel_Scheduling_List::insert(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        if(_chosen)
+            Base::insert(e);
+        else
+            _chosen = e;
+    }
+
+    Element * remove(Element * e) {
+        db<Lists>(TRC) << "Multilevel_Scheduling_List::remove(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        if(e == _chosen)
+            _chosen = Base::remove();
+        else
+            e = Base::remove(e);
+
+        return e;
+    }
+
+    Element * choose() {
+        db<Lists>(TRC) << "Multilevel_Scheduling_List::choose()" << endl;
+
+        if(!empty()) {
+            Base::insert(_chosen);
+            _chosen = Base::remove();
+        }
+
+        return _chosen;
+    }
+
+    Element * choose_another() {
+        db<Lists>(TRC) << "Multilevel_Scheduling_List::choose_another()" << endl;
+
+        if(!empty() && head()->rank() != R::IDLE) {
+            Element * tmp = _chosen;
+            _chosen = Base::remove();
+            Base::insert(tmp);
+        }
+
+        return _chosen;
+    }
+
+    Element * choose(Element * e) {
+        db<Lists>(TRC) << "Multilevel_Scheduling_List::choose(e=" << e
+                       << ") => {o=" << (e ? e->object() : (void *) -1)
+                       << ",r=" << (e ? int(e->rank()) : -1)
+                       << "}" << endl;
+
+        if(e != _chosen) {
+            Base::insert(_chosen);
+            _chosen = Base::remove(e);
+        }
+
+        return _chosen;
+    }
+
+    Element * steal() { return 0; }
+
+    Element * search_affine(unsigned int queue) {
+        for(unsigned int l = 0; l < L; l++)
+            if(Base::size(l))
+                for(Iterator i = Base::begin(l); i != Base::end(); i++)
+                    if(i->rank().affine(queue))
+                        return i;
+        return 0;
+    }
+
 private:
     using Base::remove;
     void chosen(Element * e) { _chosen = e; }
@@ -1210,6 +1568,14 @@ public:
         return _chosen[R::current_head()];
     }
 
+    Element * steal() { return 0; }
+
+    Element * search_affine(unsigned int queue) {
+        Element * e = head();
+        for(; e && !e->rank().affine(queue); e = e->next());
+        return e;
+    }
+
 private:
     using Base::remove;
     void chosen(Element * e) { _chosen[R::current_head()] = e; }
@@ -1244,6 +1610,7 @@ public:
     bool empty() const { return _list[R::current_queue()].empty(); }
 
     unsigned int size() const { return _list[R::current_queue()].size(); }
+    unsigned int size(unsigned int queue) const { return _list[queue].size(); }
     unsigned int total_size() const {
         unsigned int s = 0;
         for(unsigned int i = 0; i < Q; i++)
@@ -1297,6 +1664,25 @@ public:
         return _list[e->rank().queue()].choose(e);
     }
 
+    // Removes, from the longest queue other than the current one, the next
+    // element to be chosen among those allowed to run on the current queue
+    // (see R::affine()), unless it is an idle one. The caller is expected to
+    // move the element's rank to the current queue before inserting it back.
+    Element * steal() {
+        Element * victim = 0;
+        unsigned int longest = 0;
+        for(unsigned int i = 0; i < Q; i++)
+            if((i != R::current_queue()) && (_list[i].size() > longest)) {
+                Element * e = _list[i].search_affine(R::current_queue());
+                if(e && (e->rank() != R::IDLE)) {
+                    victim = e;
+                    longest = _list[i].size();
+                }
+            }
+
+        return victim ? _list[victim->rank().queue()].remove(victim) : 0;
+    }
+
 private:
     L _list[Q];
 };
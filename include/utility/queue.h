@@ -29,6 +29,29 @@
 // |ord|		| 4 |<--| 3 |<--| 2 |
 // +---+ 		+---+	+---+	+---+
 
+// Multilevel Queue is a priority queue with one FIFO per level (i.e. per
+// "element.rank") and a bitmap of non-empty levels. Insertions and removals
+// take constant time, no matter how many objects are queued, and objects of
+// the same rank are kept in arrival order, just like in the Ordered Queue.
+// Elements of Multilevel and Ordered Queues may be exchanged.
+// Example: insert(B,1);insert(C,3);insert(A,1)
+//   map  = 0101...
+//   [0]  = {}
+//   [1]  = {B, A}
+//   [2]  = {}
+//   [3]  = {C}
+
+// Wheel Queue is a hashed timing wheel: objects are tagged with an absolute
+// expiration time in "element.rank" and hashed by it into one of a fixed
+// number of slots. Advancing the wheel by one step moves the expired objects
+// of the current slot to a FIFO of due objects, which removals take from.
+// Insertions and removals take constant time, no matter how many objects are
+// queued. Elements of Wheel and Relative Queues may be exchanged.
+// Example (8 slots, now = 4): insert(A,5);insert(B,13);insert(C,7)
+//   [5]  = {A, B}
+//   [7]  = {C}
+//   advance() => now = 5, due = {A}
+
 // Scheduling Queue is an ordered queue whose ordering criterion is externally
 // definable and for which selecting methods are defined (e.g. choose). This
 // utility is most useful for schedulers, such as CPU or I/O.
@@ -94,6 +117,22 @@ template<typename T,
           typename El = List_Elements::Doubly_Linked_Ordered<T, R> >
 class Relative_Queue: public Queue_Wrapper<Relative_List<T, R, El>, false> {};
 
+
+// Multilevel Queue
+template<typename T,
+          typename R = List_Element_Rank,
+          typename El = List_Elements::Doubly_Linked_Ordered<T, R>,
+          unsigned int L = 32>
+class Multilevel_Queue: public Multilevel_List<T, R, El, L> {};
+
+
+// Hashed Timing Wheel Queue
+template<typename T,
+          typename R = List_Element_Rank,
+          typename El = List_Elements::Doubly_Linked_Ordered<T, R>,
+          unsigned int S = 256>
+class Wheel_Queue: public Wheel_List<T, R, El, S> {};
+
 __END_UTIL
 
 #endif
@@ -12,8 +12,16 @@ __BEGIN_UTIL
 // scheduling list
 
 // Scheduling_Queue
-template<typename T, typename R = typename T::Criterion>
-class Scheduling_Queue: public Scheduling_List<T> {};
+// Criteria exporting "multilevel" (e.g. Priority) are kept in a constant-time
+// Multilevel_Scheduling_List, all others in an ordered Scheduling_List.
+// Multicore criteria exporting more than one head (e.g. GEDF) share their
+// list among CPUs with a Multihead_Scheduling_List, while those exporting
+// more than one queue (e.g. GRR, PEDF, CEDF) get a Scheduling_Multilist of
+// those, with one list per queue (i.e. per CPU or cluster of CPUs).
+template<typename T, typename R = typename T::Criterion,
+          typename L = typename IF<(R::HEADS > 1), Multihead_Scheduling_List<T, R>,
+                                   typename IF<R::multilevel, Multilevel_Scheduling_List<T, R>, Scheduling_List<T, R>>::Result>::Result>
+class Scheduling_Queue: public IF<(R::QUEUES > 1), Scheduling_Multilist<T, R, typename L::Element, L>, L>::Result {};
 
 
 // Scheduler
@@ -93,6 +101,23 @@ public:
         return obj;
     }
 
+    // Migrates the next ready object of the longest queue of another CPU to
+    // the current one, if any
+    T * steal() {
+        db<Scheduler>(TRC) << "Scheduler[chosen=" << chosen() << "]::steal() => ";
+
+        typename Base::Element * e = Base::steal();
+        T * obj = e ? e->object() : 0;
+        if(obj) {
+            obj->criterion().queue(Criterion::current_queue());
+            Base::insert(e);
+        }
+
+        db<Scheduler>(TRC) << obj << endl;
+
+        return obj;
+    }
+
     T * choose(T * obj) {
         db<Scheduler>(TRC) << "Scheduler[chosen=" << chosen() << "]::choose(" << obj;
 
@@ -71,6 +71,38 @@ private:
     volatile bool _locked;
 };
 
+// Flat Spin Lock owned by a CPU
+// Acquiring it again on the owner CPU has no effect and releasing it on any
+// other CPU is ignored, so the lock can be handed over from a thread to the
+// next one dispatched on the same CPU. Interrupts must be disabled on the
+// owner CPU while the lock is taken.
+class CPU_Spin
+{
+public:
+    CPU_Spin(): _owner(0) {}
+
+    void acquire() {
+        unsigned int me = CPU::id() + 1;
+
+        while(CPU::cas(_owner, 0U, me) != me);
+
+        db<Spin>(TRC) << "CPU_Spin::acquire[this=" << this << ",cpu=" << me - 1 << "]()" << endl;
+    }
+
+    void release() {
+        db<Spin>(TRC) << "CPU_Spin::release[this=" << this << ",owner=" << _owner << "]()" << endl;
+
+        if(_owner == CPU::id() + 1)
+            _owner = 0;
+    }
+
+    volatile bool taken() const { return (_owner != 0); }
+    volatile bool held() const { return (_owner == CPU::id() + 1); }
+
+private:
+    volatile unsigned int _owner;
+};
+
 __END_UTIL
 
 #endif
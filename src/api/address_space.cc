@@ -0,0 +1,66 @@
+// EPOS Address_Space Implementation
+
+#include <memory.h>
+
+__BEGIN_SYS
+
+Address_Space::Address_Space()
+{
+    db<Address_Space>(TRC) << "Address_Space() => " << this << endl;
+}
+
+
+Address_Space::Address_Space(MMU::Page_Directory * pd) : MMU::Directory(pd)
+{
+    db<Address_Space>(TRC) << "Address_Space(pd=" << pd << ") => " << this << endl;
+}
+
+
+Address_Space::~Address_Space()
+{
+    db<Address_Space>(TRC) << "~Address_Space(this=" << this << ")" << endl;
+}
+
+
+Address_Space::Log_Addr Address_Space::attach(Segment * seg)
+{
+    Log_Addr tmp = MMU::Directory::attach(*seg);
+
+    db<Address_Space>(TRC) << "Address_Space::attach(this=" << this << ",seg=" << seg << ") => " << tmp << endl;
+
+    return tmp;
+}
+
+
+Address_Space::Log_Addr Address_Space::attach(Segment * seg, const Log_Addr & addr)
+{
+    Log_Addr tmp = MMU::Directory::attach(*seg, addr);
+
+    db<Address_Space>(TRC) << "Address_Space::attach(this=" << this << ",seg=" << seg << ",addr=" << addr << ") => " << tmp << endl;
+
+    return tmp;
+}
+
+
+void Address_Space::detach(Segment * seg)
+{
+    db<Address_Space>(TRC) << "Address_Space::detach(this=" << this << ",seg=" << seg << ")" << endl;
+
+    MMU::Directory::detach(*seg);
+}
+
+
+void Address_Space::detach(Segment * seg, const Log_Addr & addr)
+{
+    db<Address_Space>(TRC) << "Address_Space::detach(this=" << this << ",seg=" << seg << ",addr=" << addr << ")" << endl;
+
+    MMU::Directory::detach(*seg, addr);
+}
+
+
+Address_Space::Phy_Addr Address_Space::physical(const Log_Addr & address)
+{
+    return MMU::Directory::physical(address);
+}
+
+__END_SYS
@@ -9,20 +9,24 @@ __BEGIN_SYS
 
 Alarm_Timer * Alarm::_timer;
 volatile Alarm::Tick Alarm::_elapsed;
+volatile Alarm::Tick Alarm::_last;
+TSC::Time_Stamp Alarm::_base;
 Alarm::Queue Alarm::_request;
+Alarm * Alarm::_next;
+Alarm::Wheel Alarm::_wheel;
 
 inline void Alarm::lock() { Thread::lock(); }
 inline void Alarm::unlock() { Thread::unlock(); }
 
 Alarm::Alarm(const Microsecond & time, Handler * handler, unsigned int times)
-: _time(time), _handler(handler), _times(times), _ticks(ticks(time)), _link(this, _ticks)
+: _time(time), _handler(handler), _times(times), _ticks(ticks(time)), _link(this, _ticks), _softirq(handler)
 {
     lock();
 
     db<Alarm>(TRC) << "Alarm(t=" << time << ",tk=" << _ticks << ",h=" << reinterpret_cast<void *>(handler) << ",x=" << times << ") => " << this << endl;
 
     if(_ticks) {
-        _request.insert(&_link);
+        insert(&_link);
         unlock();
     } else {
         unlock();
@@ -37,7 +41,7 @@ Alarm::~Alarm()
 
     db<Alarm>(TRC) << "~Alarm(this=" << this << ")" << endl;
 
-    _request.remove(this);
+    remove(&_link);
 
     unlock();
 }
@@ -50,9 +54,9 @@ void Alarm::reset()
 
     db<Alarm>(TRC) << "Alarm::reset(this=" << this << ")" << endl;
 
-    _request.remove(this);
+    remove(&_link);
     _link.rank(_ticks);
-    _request.insert(&_link);
+    insert(&_link);
 
     if(!locked)
         unlock();
@@ -66,33 +70,168 @@ void Alarm::period(const Microsecond & p)
 
     db<Alarm>(TRC) << "Alarm::period(this=" << this << ",p=" << p << ")" << endl;
 
-    _request.remove(this);
+    remove(&_link);
     _time = p;
     _ticks = ticks(p);
-    _request.insert(&_link);
+    _link.rank(_ticks);
+    insert(&_link);
 
     if(!locked)
         unlock();
 }
 
 
+// A thread sleeping in delay()
+class Alarm::Sleeper
+{
+public:
+    Sleeper(): expired(false) {}
+
+    volatile bool expired;
+    Thread::Queue queue;
+};
+
+
 void Alarm::delay(const Microsecond & time)
 {
     db<Alarm>(TRC) << "Alarm::delay(time=" << time << ")" << endl;
 
-    Tick t = _elapsed + ticks(time);
+    // Sub-tick delays, and those requested before threads exist or with the
+    // lock held (e.g. by device drivers), busy-wait on the TSC
+    if((time < timer_period()) || !Thread::running() || Thread::locked()) {
+        TSC::Time_Stamp end = TSC::time_stamp() + TSC::Time_Stamp(time) * TSC::frequency() / 1000000;
+        while(TSC::time_stamp() < end);
+        return;
+    }
+
+    // Other threads use the CPU while the caller sleeps until the internal
+    // alarm expires, which might happen even before it gets to sleep
+    Sleeper sleeper;
+    Functor_Handler<Sleeper> handler(&wakeup, &sleeper);
+    Alarm alarm(time, &handler);
+
+    lock();
+    if(!sleeper.expired)
+        Thread::sleep(&sleeper.queue);
+    unlock();
+}
+
+
+// Called by handler(), thus with the lock held, or by a Softirq (if deferred)
+void Alarm::wakeup(Sleeper * sleeper)
+{
+    bool locked = Thread::locked();
+    if(!locked)
+        lock();
+
+    sleeper->expired = true;
+    Thread::wakeup(&sleeper->queue);
 
-    while(_elapsed < t);
+    if(!locked)
+        unlock();
+}
+
+
+// Called with the lock held
+void Alarm::insert(Queue::Element * e)
+{
+    if(wheel) {
+        // Ranks in the wheel are absolute, while e's is relative to now
+        e->rank(_wheel.now() + e->rank());
+        _wheel.insert(e);
+    } else if(tickless) {
+        // Ranks in the queue are relative to _last, while e's is relative to now
+        e->rank(e->rank() + (elapsed() - _last));
+        _request.insert(e);
+        if(_request.head() == e)
+            program();
+    } else
+        _request.insert(e);
+}
+
+
+// Called with the lock held. An alarm already taken from _request to fire
+// next (see handler()) is dropped, so it isn't fired after being destroyed
+// or with its former period.
+void Alarm::remove(Queue::Element * e)
+{
+    if(wheel)
+        _wheel.remove(e);
+    else {
+        _request.remove(e->object());
+        if(_next == e->object())
+            _next = 0;
+    }
+}
+
+
+// Programs the timer for the head of the queue, if any (tickless only)
+void Alarm::program()
+{
+    if(_request.empty())
+        _timer->program(0);
+    else {
+        Tick next = _request.head()->rank() - (elapsed() - _last);
+        _timer->program((next > 0) ? next : 1);
+    }
+}
+
+
+// Called with the lock held. Deferred handlers are only raised here and run
+// after the ISR returns, thus after unlock().
+void Alarm::fire(Alarm * alarm)
+{
+    db<Alarm>(TRC) << "Alarm::handler(h=" << reinterpret_cast<void *>(alarm->_handler) << ")" << endl;
+
+    if(deferred)
+        alarm->_softirq.raise();
+    else
+        (*alarm->_handler)();
 }
 
 
 void Alarm::handler(IC::Interrupt_Id i)
 {
     static Tick next_tick;
-    static Handler * next_handler;
 
     lock();
 
+    if(tickless) {
+        // All alarms due by now are handled, one at a time: the queue is
+        // rebased on the current time, its head is taken if due and the timer
+        // is reprogrammed before the handler is called, since handlers might
+        // release threads and thus cause a context switch
+        for(Alarm * due; ; ) {
+            Tick now = elapsed();
+            due = 0;
+            if(!_request.empty()) {
+                Queue::Element * e = _request.head();
+                e->rank(e->rank() - (now - _last));
+                if(e->rank() <= 0) {
+                    Tick late = e->rank();
+                    _request.remove(e);
+                    Alarm * alarm = e->object();
+                    due = alarm;
+                    if(alarm->_times != INFINITE)
+                        alarm->_times--;
+                    if(alarm->_times) {
+                        e->rank(alarm->_ticks + late);
+                        _request.insert(e);
+                    }
+                }
+            }
+            _last = now;
+            program();
+
+            if(!due)
+                break;
+            fire(due);
+        }
+
+        unlock();
+        return;
+    }
+
     _elapsed++;
 
     if(Traits<Alarm>::visible) {
@@ -104,20 +243,40 @@ void Alarm::handler(IC::Interrupt_Id i)
         display.position(lin, col);
     }
 
+    if(wheel) {
+        // All alarms due at this tick are taken from the wheel and updated.
+        // Their handlers are deferred (i.e. fire() only raises their Softirqs),
+        // so they only run after the ISR returns, with the wheel consistent.
+        _wheel.advance();
+        for(Queue::Element * e; (e = _wheel.remove()); ) {
+            Alarm * alarm = e->object();
+            if(alarm->_times != INFINITE)
+                alarm->_times--;
+            if(alarm->_times) {
+                e->rank(alarm->_ticks);
+                insert(e);
+            }
+
+            fire(alarm);
+        }
+
+        unlock();
+        return;
+    }
+
     if(next_tick)
         next_tick--;
     if(!next_tick) {
-        if(next_handler) {
-            db<Alarm>(TRC) << "Alarm::handler(h=" << reinterpret_cast<void *>(next_handler) << ")" << endl;
-            (*next_handler)();
-        }
+        // The queue is updated before the handler is called, since handlers
+        // might release threads and thus cause a context switch
+        Alarm * due = _next;
         if(_request.empty())
-            next_handler = 0;
+            _next = 0;
         else {
             Queue::Element * e = _request.remove();
             Alarm * alarm = e->object();
             next_tick = alarm->_ticks;
-            next_handler = alarm->_handler;
+            _next = alarm;
             if(alarm->_times != INFINITE)
                 alarm->_times--;
             if(alarm->_times) {
@@ -125,6 +284,8 @@ void Alarm::handler(IC::Interrupt_Id i)
                 _request.insert(e);
             }
         }
+        if(due)
+            fire(due);
     }
 
     unlock();
@@ -9,6 +9,7 @@ void Alarm::init()
 {
     db<Init, Alarm>(TRC) << "Alarm::init()" << endl;
 
+    _base = TSC::time_stamp();
     _timer = new (kmalloc(sizeof(Alarm_Timer))) Alarm_Timer(handler);
 }
 
@@ -2,9 +2,6 @@
 
 #include <synchronizer.h>
 
-// This is actually no Condition Variable
-// check http://www.cs.duke.edu/courses/spring01/cps110/slides/sem/sld002.htm
-
 __BEGIN_SYS
 
 // Methods
@@ -23,7 +20,24 @@ void Condition::wait() {
     db<Synchronizer>(TRC) << "Condition::wait(this=" << this << ")" << endl;
 
     begin_atomic();
-    sleep(); // implicit end_atomic()
+    sleep();
+    end_atomic();
+}
+
+
+void Condition::wait(Mutex * mutex) {
+    db<Synchronizer>(TRC) << "Condition::wait(this=" << this << ",mutex=" << mutex << ")" << endl;
+
+    // Releasing the mutex and sleeping must be atomic, or a signal() issued
+    // in between would be lost. Hence the mutex is released without
+    // preemption: the thread taking it over only runs after this one is
+    // in the queue.
+    begin_atomic();
+    mutex->release(false);
+    sleep();
+    end_atomic();
+
+    mutex->lock();
 }
 
 
@@ -31,7 +45,8 @@ void Condition::signal() {
     db<Synchronizer>(TRC) << "Condition::signal(this=" << this << ")" << endl;
 
     begin_atomic();
-    wakeup(); // implicit end_atomic()
+    wakeup();
+    end_atomic();
 }
 
 
@@ -39,7 +54,8 @@ void Condition::broadcast() {
     db<Synchronizer>(TRC) << "Condition::broadcast(this=" << this << ")" << endl;
 
     begin_atomic();
-    wakeup_all(); // implicit end_atomic()
+    wakeup_all();
+    end_atomic();
 }
 
 // This is an alternative implementation, which does impose ordering
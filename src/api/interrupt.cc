@@ -0,0 +1,132 @@
+// EPOS Deferred Interrupt Handling Implementation
+
+#include <system.h>
+#include <interrupt.h>
+
+__BEGIN_SYS
+
+Softirq::Queue Softirq::_queue[Softirq::CPUS];
+Simple_Spin Softirq::_lock;
+
+Softirq::~Softirq()
+{
+    db<Softirq>(TRC) << "~Softirq(this=" << this << ")" << endl;
+
+    bool disabled = lock();
+    if(_pending) {
+        _queue[_cpu].remove(&_link);
+        _pending = false;
+    }
+    unlock(disabled);
+}
+
+
+void Softirq::raise()
+{
+    bool disabled = lock();
+    if(!_pending) {
+        _pending = true;
+        _cpu = CPU::id();
+        _queue[_cpu].insert(&_link);
+    }
+    unlock(disabled);
+}
+
+
+// Called by IC::dispatch() as the interrupt returns. Interrupts are enabled
+// only while softirqs run and are left disabled. Handlers might release
+// threads and thus cause a context switch, so each thread, instead of each
+// CPU, drains at most once at a time: nested interrupts only add to the
+// queue, while the threads dispatched in the meantime are free to drain it.
+void Softirq::drain()
+{
+    CPU::int_disable();
+
+    Thread * self = Thread::running();
+    if(!self || self->_softirqs)
+        return;
+
+    self->_softirqs = true;
+    for(;;) {
+        if(smp)
+            _lock.acquire();
+        Queue::Element * e = _queue[CPU::id()].remove();
+        if(e)
+            e->object()->_pending = false;
+        if(smp)
+            _lock.release();
+        if(!e)
+            break;
+
+        Softirq * s = e->object();
+
+        db<Softirq>(TRC) << "Softirq::drain(s=" << s << ",h=" << reinterpret_cast<void *>(s->_handler) << ")" << endl;
+
+        CPU::int_enable();
+        (*s->_handler)();
+        CPU::int_disable();
+    }
+    self->_softirqs = false;
+}
+
+
+Interrupt_Thread::Interrupt_Thread(Handler * handler, const Thread::Criterion & priority)
+: _handler(handler), _runs(0), _finishing(false)
+{
+    _thread = new (SYSTEM) Thread(Thread::Configuration(Thread::READY, priority), &run, this);
+
+    db<Softirq>(TRC) << "Interrupt_Thread(h=" << reinterpret_cast<void *>(handler) << ",t=" << _thread << ") => " << this << endl;
+}
+
+
+Interrupt_Thread::~Interrupt_Thread()
+{
+    db<Softirq>(TRC) << "~Interrupt_Thread(this=" << this << ")" << endl;
+
+    Thread::lock();
+    _finishing = true;
+    Thread::wakeup(&_queue);
+    Thread::unlock();
+
+    _thread->join();
+
+    // Allocated with new (SYSTEM), so it must go back to the system heap
+    _thread->~Thread();
+    kfree(_thread);
+}
+
+
+void Interrupt_Thread::operator()()
+{
+    bool locked = Thread::locked();
+    if(!locked)
+        Thread::lock();
+
+    _runs++;
+    Thread::wakeup(&_queue);
+
+    if(!locked)
+        Thread::unlock();
+}
+
+
+int Interrupt_Thread::run(Interrupt_Thread * it)
+{
+    for(;;) {
+        Thread::lock();
+        while(!it->_runs && !it->_finishing)
+            Thread::sleep(&it->_queue);
+        bool finishing = it->_finishing;
+        if(!finishing)
+            it->_runs--;
+        Thread::unlock();
+
+        if(finishing)
+            break;
+        (*it->_handler)();
+    }
+
+    return 0;
+}
+
+__END_SYS
@@ -4,9 +4,10 @@
 
 __BEGIN_SYS
 
-Mutex::Mutex(): _locked(false)
+Mutex::Mutex(const Criterion & ceiling)
+: _locked(false), _owner(0), _ceiling(ceiling), _boosted(false), _boosts(0), _boost_start(0), _boost_time(0)
 {
-    db<Synchronizer>(TRC) << "Mutex() => " << this << endl;
+    db<Synchronizer>(TRC) << "Mutex(ceiling=" << _ceiling << ") => " << this << endl;
 }
 
 
@@ -21,11 +22,13 @@ void Mutex::lock()
     db<Synchronizer>(TRC) << "Mutex::lock(this=" << this << ")" << endl;
 
     begin_atomic();
-    if(tsl(_locked))
-        while(tsl(_locked))
-            sleep(); // implicit end_atomic()
-    else
-        end_atomic();
+    if(tsl(_locked)) {
+        if((PROTOCOL == Traits<Build>::INHERITANCE) && (running()->criterion() < _owner->criterion()))
+            boost(running()->criterion());
+        sleep(); // the mutex is handed over by release()
+    } else
+        acquire(running());
+    end_atomic();
 }
 
 
@@ -34,8 +37,67 @@ void Mutex::unlock()
     db<Synchronizer>(TRC) << "Mutex::unlock(this=" << this << ")" << endl;
 
     begin_atomic();
-    _locked = false;
-    wakeup(); // implicit end_atomic()
+    release();
+    end_atomic();
+}
+
+
+void Mutex::acquire(Thread * t)
+{
+    _owner = t;
+    _priority = t->criterion();
+
+    if((PROTOCOL == Traits<Build>::CEILING) && (_ceiling < t->criterion()))
+        boost(_ceiling);
+}
+
+
+// Without preempt, the running thread is not rescheduled, neither for
+// the thread taking over the mutex nor for its own restored priority
+void Mutex::release(bool preempt)
+{
+    bool restored = restore();
+
+    // Waiting threads take over the mutex, which therefore remains locked
+    if(_queue.empty()) {
+        _locked = false;
+        _owner = 0;
+        if(restored && preempt)
+            reschedule();
+    } else {
+        acquire(_queue.head()->object());
+        wakeup(preempt);
+    }
+}
+
+
+void Mutex::boost(const Criterion & c)
+{
+    db<Synchronizer>(TRC) << "Mutex::boost(this=" << this << ",owner=" << _owner << ",prio=" << c << ")" << endl;
+
+    if(!_boosted) {
+        _boosted = true;
+        _boosts++;
+        _boost_start = TSC::time_stamp();
+    }
+
+    prioritize(_owner, c);
+}
+
+
+bool Mutex::restore()
+{
+    if(!_boosted)
+        return false;
+
+    db<Synchronizer>(TRC) << "Mutex::restore(this=" << this << ",owner=" << _owner << ",prio=" << _priority << ")" << endl;
+
+    _boosted = false;
+    _boost_time += TSC::time_stamp() - _boost_start;
+
+    prioritize(_owner, _priority);
+
+    return true;
 }
 
 __END_SYS
@@ -0,0 +1,100 @@
+// EPOS Real-time Implementation
+
+#include <real-time.h>
+
+__BEGIN_SYS
+
+volatile unsigned int Periodic_Thread::_deadline_misses;
+
+volatile bool Periodic_Thread::wait_next()
+{
+    Periodic_Thread * t = reinterpret_cast<Periodic_Thread *>(running());
+
+    lock();
+
+    db<Thread>(TRC) << "Periodic_Thread::wait_next(this=" << t << ",times=" << t->_times << ",pending=" << t->_pending << ")" << endl;
+
+    t->account(Alarm::elapsed() - t->_release);
+    t->_release += Alarm::ticks(t->_period);
+
+    if(t->_times != INFINITE)
+        t->_times--;
+
+    if(t->_times) {
+        if(t->_pending) {
+            // Overrun: the next job has already been released, so it starts right
+            // away, with the deadline of its nominal release (i.e. _release)
+            if(Criterion::dynamic) {
+                t->criterion().update(t->_release);
+                if(preemptive)
+                    reschedule();
+            }
+        } else {
+            t->_waiting = true;
+            t->suspend(); // implicit unlock()
+            lock();
+        }
+        t->_pending--;
+    }
+
+    unlock();
+
+    return t->_times;
+}
+
+
+void Periodic_Thread::account(const Tick & response)
+{
+    if((_jobs == 0) || (response < _min_response))
+        _min_response = response;
+    if(response > _max_response)
+        _max_response = response;
+    _total_response += response;
+    _jobs++;
+
+    if(response > _deadline) {
+        _misses++;
+        _deadline_misses++;
+
+        db<Thread>(WRN) << "Periodic_Thread::wait_next: deadline miss (this=" << this << ",job=" << _jobs << ",response=" << response << ",deadline=" << _deadline << ")" << endl;
+    }
+}
+
+
+// Called by the Alarm handler, thus with the lock held, or by a Softirq (if deferred)
+void Periodic_Thread::release(Periodic_Thread * t)
+{
+    db<Thread>(TRC) << "Periodic_Thread::release(this=" << t << ",pending=" << t->_pending << ")" << endl;
+
+    bool locked = Thread::locked();
+    if(!locked)
+        lock();
+
+    if(t->_activation) {
+        // First release: the job starts now and the following ones every period
+        t->_activation = false;
+        t->_release = Alarm::elapsed();
+        t->_alarm.period(t->_period);
+    } else
+        t->_pending++;
+
+    if(t->_waiting) {
+        t->_waiting = false;
+
+        // The scheduling list is ranked by criterion, so dynamic ranks must be
+        // updated while the thread is out of it
+        if(Criterion::dynamic)
+            t->criterion().update(t->_release);
+
+        t->_state = READY;
+        _scheduler.resume(t);
+
+        if(preemptive)
+            reschedule(t->criterion().queue());
+    }
+
+    if(!locked)
+        unlock();
+}
+
+__END_SYS
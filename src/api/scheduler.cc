@@ -0,0 +1,19 @@
+// EPOS CPU Scheduler Component Implementation
+
+#include <process.h>
+#include <time.h>
+
+__BEGIN_SYS
+
+// The following Scheduling Criteria depend on Alarm, which is not available at scheduler.h
+FCFS::FCFS(int p): Priority((p == IDLE) ? IDLE : int(Alarm::elapsed())) {}
+
+EDF::EDF(const Microsecond & d, const Microsecond & p, const Microsecond & c, unsigned int cpu)
+: RT_Common(int(Alarm::elapsed() + Alarm::ticks(d)), d, p ? p : d, c) {}
+
+void EDF::update(int release) {
+    if((_priority >= PERIODIC) && (_priority < APERIODIC))
+        _priority = release + Alarm::ticks(_deadline);
+}
+
+__END_SYS
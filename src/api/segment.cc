@@ -0,0 +1,44 @@
+// EPOS Segment Implementation
+
+#include <memory.h>
+
+__BEGIN_SYS
+
+Segment::Segment(unsigned int bytes, const Flags & flags) : Chunk(bytes, flags)
+{
+    db<Segment>(TRC) << "Segment(bytes=" << bytes << ",flags=" << flags << ") => " << this << endl;
+}
+
+
+Segment::Segment(const Phy_Addr & phy_addr, unsigned int bytes, const Flags & flags) : Chunk(phy_addr, bytes, flags)
+{
+    db<Segment>(TRC) << "Segment(bytes=" << bytes << ",phy=" << phy_addr << ",flags=" << flags << ") => " << this << endl;
+}
+
+
+Segment::~Segment()
+{
+    db<Segment>(TRC) << "~Segment(this=" << this << ")" << endl;
+}
+
+
+unsigned int Segment::size() const
+{
+    return Chunk::size();
+}
+
+
+Segment::Phy_Addr Segment::phy_address() const
+{
+    return Chunk::phy_address();
+}
+
+
+int Segment::resize(int amount)
+{
+    db<Segment>(TRC) << "Segment::resize(this=" << this << ",amount=" << amount << ")" << endl;
+
+    return Chunk::resize(amount);
+}
+
+__END_SYS
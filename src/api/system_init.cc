@@ -8,7 +8,8 @@ __BEGIN_SYS
 
 void System::init()
 {
-    if(Traits<Alarm>::enabled)
+    // Alarms are handled by CPU 0 only (see Timer::int_handler())
+    if(Traits<Alarm>::enabled && (CPU::id() == 0))
         Alarm::init();
 
     if(Traits<Thread>::enabled)
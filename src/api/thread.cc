@@ -11,17 +11,36 @@ __END_UTIL
 
 __BEGIN_SYS
 
+volatile unsigned int Thread::_thread_count;
 Scheduler_Timer * Thread::_timer;
-
-Thread* volatile Thread::_running;
-Thread::Queue Thread::_ready;
-Thread::Queue Thread::_suspended;
+Scheduler<Thread> Thread::_scheduler;
+CPU_Spin Thread::_lock;
+Block_Cache<Thread::STACK_POOL> Thread::_stacks;
 
 void Thread::constructor_prologue(unsigned int stack_size)
 {
     lock();
 
-    _stack = reinterpret_cast<char *>(kmalloc(stack_size));
+    _thread_count++;
+    _scheduler.insert(this);
+
+    // Stacks of deleted threads are recycled (see Traits<Thread>::pooled).
+    // Cached stacks (of other sizes) go back to the heap if it can't hold a
+    // new one, so they never run it out of memory.
+    _stack = pooled ? reinterpret_cast<char *>(_stacks.get(stack_size)) : 0;
+    if(pooled && !_stack)
+        for(void * cached; !(_stack = reinterpret_cast<char *>(try_kmalloc(stack_size))) && (cached = _stacks.remove()); )
+            kfree(cached);
+    if(!_stack)
+        _stack = reinterpret_cast<char *>(kmalloc(stack_size));
+    _stack_size = stack_size;
+
+    if(guarded)
+        for(unsigned int i = 1; i <= CANARIES; i++)
+            reinterpret_cast<unsigned int *>(_stack)[i] = CANARY;
+
+    _fpu = lazy_fpu ? new (kmalloc(sizeof(FPU_Context))) FPU_Context : 0;
+    _softirqs = false;
 }
 
 
@@ -35,11 +54,11 @@ void Thread::constructor_epilogue(const Log_Addr & entry, unsigned int stack_siz
                     << "},context={b=" << _context
                     << "," << *_context << "}) => " << this << endl;
 
-    switch(_state) {
-        case RUNNING: break;
-        case SUSPENDED: _suspended.insert(&_link); break;
-        default: _ready.insert(&_link);
-    }
+    if(_state == SUSPENDED)
+        _scheduler.suspend(this);
+
+    if(preemptive && (_state == READY) && (_link.rank() != IDLE))
+        reschedule(_link.rank().queue());
 
     unlock();
 }
@@ -56,12 +75,86 @@ Thread::~Thread()
                     << ",context={b=" << _context
                     << "," << *_context << "})" << endl;
 
-    _ready.remove(this);
-    _suspended.remove(this);
+    // The running thread cannot delete itself!
+    assert(_state != RUNNING);
+
+    switch(_state) {
+    case RUNNING:  // For switch completion only: the running thread would have deleted itself! Stack wouldn't have been released!
+        exit(-1);
+        break;
+    case READY:
+        _scheduler.remove(this);
+        _thread_count--;
+        break;
+    case SUSPENDED:
+        _thread_count--;
+        break;
+    case WAITING:
+        _waiting->remove(this);
+        _thread_count--;
+        break;
+    case FINISHING: // Already called exit()
+        break;
+    }
+
+    bool recycled = pooled && _stacks.put(_stack, _stack_size);
+
+    if(lazy_fpu)
+        CPU::fpu_release(_fpu);
+
+    unlock();
+
+    if(!recycled)
+        kfree(_stack);
+    if(lazy_fpu)
+        kfree(_fpu);
+}
+
+
+void Thread::priority(const Criterion & c)
+{
+    lock();
+
+    db<Thread>(TRC) << "Thread::priority(this=" << this << ",prio=" << c << ")" << endl;
+
+    prioritize(c);
+
+    if(preemptive)
+        reschedule(_link.rank().queue());
 
     unlock();
+}
+
 
-    kfree(_stack);
+void Thread::prioritize(const Criterion & c)
+{
+    // lock() must be called before entering this method
+    assert(locked());
+
+    db<Thread>(TRC) << "Thread::prioritize(this=" << this << ",prio=" << c << ")" << endl;
+
+    // Changing priorities neither migrates threads among CPUs nor changes their affinity
+    unsigned int queue = _link.rank().queue();
+    unsigned int affinity = _link.rank().affinity();
+
+    // Ready and waiting threads must be requeued, since both lists are ordered by rank
+    if(_state == READY) {
+        _scheduler.remove(this);
+        _link.rank(c);
+        criterion().affinity(affinity);
+        criterion().queue(queue);
+        _scheduler.insert(this);
+    } else if(_state == WAITING) {
+        _waiting->remove(this);
+        _link.rank(c);
+        criterion().affinity(affinity);
+        criterion().queue(queue);
+        _waiting->insert(&_link);
+    } else {
+        _link.rank(c);
+        criterion().affinity(affinity);
+        criterion().queue(queue);
+    }
 }
 
 
@@ -71,8 +164,23 @@ int Thread::join()
 
     db<Thread>(TRC) << "Thread::join(this=" << this << ",state=" << _state << ")" << endl;
 
-    while(_state != FINISHING)
-        yield(); // implicit unlock()
+    // Precondition: no Thread::self()->join()
+    assert(running() != this);
+
+    // Precondition: a single joiner
+    assert(!_joining);
+
+    if(_state != FINISHING) {
+        Thread * prev = running();
+
+        _joining = prev;
+        prev->_state = SUSPENDED;
+        _scheduler.suspend(prev); // implicitly choose() if suspending chosen()
+
+        Thread * next = _scheduler.chosen();
+
+        dispatch(prev, next);
+    }
 
     unlock();
 
@@ -86,15 +194,25 @@ void Thread::pass()
 
     db<Thread>(TRC) << "Thread::pass(this=" << this << ")" << endl;
 
-    Thread * prev = _running;
-    prev->_state = READY;
-    _ready.insert(&prev->_link);
+    if((_state == READY) && !_link.rank().affine(Criterion::current_queue()))
+        db<Thread>(WRN) << "Thread::pass => thread (" << this << ") cannot run on this CPU!" << endl;
+    else if(_state == READY) {
+        // Threads ready on other CPUs are first migrated to the current one
+        if(_link.rank().queue() != Criterion::current_queue()) {
+            _scheduler.remove(this);
+            criterion().queue(Criterion::current_queue());
+            _scheduler.insert(this);
+        }
 
-    _ready.remove(this);
-    _state = RUNNING;
-    _running = this;
+        Thread * prev = running();
+        Thread * next = _scheduler.choose(this);
 
-    dispatch(prev, this);
+        dispatch(prev, next, false);
+    } else if(_state == RUNNING) {
+        if(this != running())
+            db<Thread>(WRN) << "Thread::pass => thread (" << this << ") running on another CPU!" << endl;
+    } else
+        db<Thread>(WRN) << "Thread::pass => thread (" << this << ") not ready!" << endl;
 
     unlock();
 }
@@ -106,19 +224,20 @@ void Thread::suspend()
 
     db<Thread>(TRC) << "Thread::suspend(this=" << this << ")" << endl;
 
-    if(_running != this)
-        _ready.remove(this);
+    if((_state == RUNNING) && (this != running()))
+        // Threads running on other CPUs can only suspend themselves
+        db<Thread>(WRN) << "Thread::suspend => thread (" << this << ") running on another CPU!" << endl;
+    else if((_state == READY) || (_state == RUNNING)) {
+        Thread * prev = running();
 
-    _state = SUSPENDED;
-    _suspended.insert(&_link);
+        _state = SUSPENDED;
+        _scheduler.suspend(this);
 
-    if((_running == this) && !_ready.empty()) {
-        _running = _ready.remove()->object();
-        _running->_state = RUNNING;
+        Thread * next = running();
 
-        dispatch(this, _running);
+        dispatch(prev, next);
     } else
-        idle(); // implicit unlock()
+        db<Thread>(WRN) << "Suspend called for unready object!" << endl;
 
     unlock();
 }
@@ -130,9 +249,14 @@ void Thread::resume()
 
     db<Thread>(TRC) << "Thread::resume(this=" << this << ")" << endl;
 
-    _suspended.remove(this);
-    _state = READY;
-    _ready.insert(&_link);
+    if(_state == SUSPENDED) {
+        _state = READY;
+        _scheduler.resume(this);
+
+        if(preemptive)
+            reschedule(_link.rank().queue());
+    } else
+        db<Thread>(WRN) << "Resume called for unsuspended object!" << endl;
 
     unlock();
 }
@@ -143,19 +267,12 @@ void Thread::yield()
 {
     lock();
 
-    db<Thread>(TRC) << "Thread::yield(running=" << _running << ")" << endl;
-
-    if(!_ready.empty()) {
-        Thread * prev = _running;
-        prev->_state = READY;
-        _ready.insert(&prev->_link);
+    db<Thread>(TRC) << "Thread::yield(running=" << running() << ")" << endl;
 
-        _running = _ready.remove()->object();
-        _running->_state = RUNNING;
+    Thread * prev = running();
+    Thread * next = _scheduler.choose_another();
 
-        dispatch(prev, _running);
-    } else
-        idle(); // implicit unlock()
+    dispatch(prev, next);
 
     unlock();
 }
@@ -167,52 +284,179 @@ void Thread::exit(int status)
 
     db<Thread>(TRC) << "Thread::exit(status=" << status << ") [running=" << running() << "]" << endl;
 
-    while(_ready.empty() && !_suspended.empty())
-        idle(); // implicit unlock();
-
-    lock();
+    Thread * prev = running();
+    _scheduler.remove(prev);
+    prev->_state = FINISHING;
+    *reinterpret_cast<int *>(prev->_stack) = status;
 
-    if(!_ready.empty()) {
-        Thread * prev = _running;
-        prev->_state = FINISHING;
-        *reinterpret_cast<int *>(prev->_stack) = status;
+    _thread_count--;
 
-        _running = _ready.remove()->object();
-        _running->_state = RUNNING;
+    if(prev->_joining) {
+        Thread * joining = prev->_joining;
+        prev->_joining = 0;
+        joining->_state = READY;
+        _scheduler.resume(joining);
 
-        dispatch(prev, _running);
-    } else {
-        db<Thread>(WRN) << "The last thread in the system has exited!" << endl;
-        if(reboot) {
-            db<Thread>(WRN) << "Rebooting the machine ..." << endl;
-            Machine::reboot();
-        } else {
-            db<Thread>(WRN) << "Halting the CPU ..." << endl;
-            CPU::halt();
-        }
+        // The joiner's CPU might be idle
+        if(smp && (joining->_link.rank().queue() != Criterion::current_queue()))
+            reschedule(joining->_link.rank().queue());
     }
 
+    Thread * next = _scheduler.choose(); // at least idle will always be there
+
+    dispatch(prev, next);
+
     unlock();
 }
 
 
+void Thread::sleep(Queue * q)
+{
+    db<Thread>(TRC) << "Thread::sleep(running=" << running() << ",q=" << q << ")" << endl;
+
+    // lock() must be called before entering this method
+    assert(locked());
+
+    Thread * prev = running();
+    _scheduler.suspend(prev);
+    prev->_state = WAITING;
+    prev->_waiting = q;
+    q->insert(&prev->_link);
+
+    Thread * next = running();
+
+    dispatch(prev, next);
+}
+
+
+// Without preempt, the current CPU is left alone, since its running thread
+// is about to dispatch anyway (see Condition::wait())
+void Thread::wakeup(Queue * q, bool preempt)
+{
+    db<Thread>(TRC) << "Thread::wakeup(running=" << running() << ",q=" << q << ")" << endl;
+
+    // lock() must be called before entering this method
+    assert(locked());
+
+    if(!q->empty()) {
+        Thread * t = q->remove()->object();
+        t->_state = READY;
+        t->_waiting = 0;
+        _scheduler.resume(t);
+
+        if(preemptive)
+            reschedule(t->_link.rank().queue(), preempt);
+    }
+}
+
+
+void Thread::wakeup_all(Queue * q)
+{
+    db<Thread>(TRC) << "Thread::wakeup_all(running=" << running() << ",q=" << q << ")" << endl;
+
+    // lock() must be called before entering this method
+    assert(locked());
+
+    if(!q->empty()) {
+        // Remote CPUs are notified only once, even if several threads go to them
+        unsigned int queues = 0;
+        while(!q->empty()) {
+            Thread * t = q->remove()->object();
+            t->_state = READY;
+            t->_waiting = 0;
+            _scheduler.resume(t);
+            queues |= 1 << t->_link.rank().queue();
+        }
+
+        // The current queue is the last one, since its CPU might switch to another thread
+        if(preemptive) {
+            for(unsigned int queue = 0; queue < Criterion::QUEUES; queue++)
+                if((queues & (1 << queue)) && (queue != Criterion::current_queue()))
+                    reschedule(queue);
+            if(queues & (1 << Criterion::current_queue()))
+                reschedule(Criterion::current_queue());
+        }
+    }
+}
+
+
 void Thread::reschedule()
 {
-    yield();
+    // lock() must be called before entering this method
+    assert(locked());
+
+    Thread * prev = running();
+    Thread * next = _scheduler.choose();
+
+    dispatch(prev, next);
+}
+
+
+// Preempts the CPUs serving the given queue (one per head), either directly,
+// for the current CPU (unless !preempt), or by means of an IPI to the rescheduler()
+void Thread::reschedule(unsigned int queue, bool preempt)
+{
+    // lock() must be called before entering this method
+    assert(locked());
+
+    if(!smp) {
+        if(preempt)
+            reschedule();
+    }
+    else {
+        db<Thread>(TRC) << "Thread::reschedule(queue=" << queue << ")" << endl;
+
+        bool local = false;
+        for(unsigned int cpu = queue * Criterion::HEADS; cpu < (queue + 1) * Criterion::HEADS; cpu++)
+            if(cpu == CPU::id())
+                local = true;
+            else
+                IC::ipi(cpu, IC::INT_RESCHEDULER);
+
+        // The current CPU is the last one, since it might switch to another thread
+        if(local && preempt)
+            reschedule();
+    }
+}
+
+
+void Thread::rescheduler(IC::Interrupt_Id i)
+{
+    lock();
+    reschedule();
+    unlock();
 }
 
 
 void Thread::time_slicer(IC::Interrupt_Id i)
 {
+    lock();
     reschedule();
+    unlock();
 }
 
 
-void Thread::dispatch(Thread * prev, Thread * next)
+void Thread::dispatch(Thread * prev, Thread * next, bool charge)
 {
+    if(guarded && prev->overflown()) {
+        db<Thread>(ERR) << "Thread::dispatch: stack overflow (thread=" << prev << ",stack={b=" << reinterpret_cast<void *>(prev->_stack) << ",s=" << prev->_stack_size << "})!" << endl;
+        Machine::panic();
+    }
+
+    // Passing the CPU (i.e. pass()) doesn't start a new quantum
+    // Tickless timers are stopped while idle, leaving the CPU undisturbed
+    // until some interrupt (e.g. an Alarm) makes a thread ready
+    if(charge && Criterion::timed) {
+        if(Scheduler_Timer::tickless && !smp && (next->_link.rank() == IDLE))
+            _timer->stop();
+        else
+            _timer->restart();
+    }
+
     if(prev != next) {
-        assert(prev->_state != RUNNING);
-        assert(next->_state == RUNNING);
+        if(prev->_state == RUNNING)
+            prev->_state = READY;
+        next->_state = RUNNING;
 
         db<Thread>(TRC) << "Thread::dispatch(prev=" << prev << ",next=" << next << ")" << endl;
         db<Thread>(INF) << "prev={" << prev << ",ctx=" << *prev->_context << "}" << endl;
@@ -223,20 +467,59 @@ void Thread::dispatch(Thread * prev, Thread * next)
         // passing the volatile to switch_constext forces it to push prev onto the stack,
         // disrupting the context (it doesn't make a difference for Intel, which already saves
         // parameters on the stack anyway).
+        if(lazy_fpu)
+            CPU::fpu_switch(prev->_fpu, next->_fpu);
+
+        // The interrupt priority mask raised by a handler that switches threads
+        // belongs to the interrupted thread and must not hold back the next one
+        IC::Priority mask = IC::mask();
+        if(IC::nested)
+            IC::mask(IC::UNMASKED);
+
         CPU::switch_context(const_cast<Context **>(&prev->_context), next->_context);
+
+        if(IC::nested)
+            IC::mask(mask);
     }
 }
 
 
 int Thread::idle()
 {
-    db<Thread>(TRC) << "Thread::idle()" << endl;
+    db<Thread>(TRC) << "Thread::idle(this=" << running() << ")" << endl;
 
-    db<Thread>(INF) << "There are no runnable threads at the moment!" << endl;
-    db<Thread>(INF) << "Halting the CPU ..." << endl;
+    while(_thread_count > (smp ? Traits<Machine>::CPUS : 1)) { // someone else besides idle(s)
+        if(Traits<Thread>::trace_idle)
+            db<Thread>(TRC) << "Thread::idle(this=" << running() << ")" << endl;
 
-    unlock();
-    CPU::halt();
+        CPU::int_enable();
+        CPU::halt();
+
+        // Idle CPUs steal ready threads from the others (see Scheduler::steal())
+        if(smp) {
+            lock();
+            if(!_scheduler.schedulables())
+                _scheduler.steal();
+            unlock();
+        }
+
+        if(_scheduler.schedulables()) // a thread might have been woken up by an interrupt
+            yield();
+    }
+
+    CPU::int_disable();
+    db<Thread>(WRN) << "The last thread has exited!" << endl;
+    if(Traits<Heaps>::profiled && (CPU::id() == 0)) {
+        kout << "System's heap: " << System::heap_profile() << endl;
+        kout << "Application's heap: " << Application::heap_profile() << endl;
+    }
+    if(reboot) {
+        db<Thread>(WRN) << "Rebooting the machine ..." << endl;
+        Machine::reboot();
+    } else {
+        db<Thread>(WRN) << "Halting the machine ..." << endl;
+        CPU::halt();
+    }
 
     return 0;
 }
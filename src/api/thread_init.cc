@@ -16,13 +16,33 @@ void Thread::init()
     // If EPOS is a library, then adjust the application entry point to __epos_app_entry,
     // which will directly call main(). In this case, _init will have already been called,
     // before Init_Application to construct MAIN's global objects.
-    Thread::_running = new (kmalloc(sizeof(Thread))) Thread(Thread::Configuration(Thread::RUNNING, Thread::NORMAL), reinterpret_cast<int (*)()>(__epos_app_entry));
+    if(CPU::id() == 0) {
+        Criterion::init();
 
-    _timer = new (kmalloc(sizeof(Scheduler_Timer))) Scheduler_Timer(QUANTUM, time_slicer);
+        new (kmalloc(sizeof(Thread))) Thread(Thread::Configuration(Thread::RUNNING, Thread::NORMAL), reinterpret_cast<int (*)()>(__epos_app_entry));
+    }
+
+    // Each CPU has its own idle thread, created in its own queue
+    // Idle thread creation does not cause rescheduling (see Thread::constructor_epilogue)
+    new (kmalloc(sizeof(Thread))) Thread(Thread::Configuration(Thread::READY, Thread::IDLE), &Thread::idle);
+
+    if(smp) {
+        if(CPU::id() == 0)
+            IC::int_vector(IC::INT_RESCHEDULER, rescheduler);
+        IC::enable(IC::INT_RESCHEDULER);
+    }
 
     // No more interrupts until we reach init_first
     CPU::int_disable();
 
+    // All idle threads must exist before the scheduler timer starts preempting CPUs
+    if(smp)
+        CPU::smp_barrier();
+
+    // The installation of the scheduler timer must precede the dispatching of the first thread
+    if(Criterion::timed && (CPU::id() == 0))
+        _timer = new (kmalloc(sizeof(Scheduler_Timer))) Scheduler_Timer(QUANTUM, time_slicer);
+
     // Transition from CPU-based locking to thread-based locking
     This_Thread::not_booting();
 }
@@ -2,11 +2,15 @@
 
 #include <architecture/armv7/armv7_cpu.h>
 
+extern "C" { bool _fpu_trap() __attribute__ ((alias("_ZN4EPOS1S3CPU8fpu_trapEv"))); }
+
 __BEGIN_SYS
 
 // Class attributes
 unsigned int CPU::_cpu_clock;
 unsigned int CPU::_bus_clock;
+CPU::FPU_Context * CPU::_fpu_owner[Traits<Build>::CPUS];
+CPU::FPU_Context * CPU::_fpu_running[Traits<Build>::CPUS];
 
 // Class methods
 void CPU::Context::save() volatile
@@ -51,7 +55,7 @@ if(thumb)
         "       pop     {r12}                   \n"     // restore r12 used as temporary
         "       push    {r0-r12, lr}            \n");   // push all registers (LR first, r0 last)
 
-if(Traits<FPU>::enabled && !Traits<FPU>::user_save)
+if(Traits<FPU>::enabled && !Traits<FPU>::user_save && !Traits<FPU>::lazy)
     ASM("       vpush   {s0-s15}                \n"     // save FPU registers
         "       vpush   {s16-s31}               \n");
 
@@ -67,7 +71,7 @@ if(Traits<FPU>::enabled && !Traits<FPU>::user_save)
     ASM("       pop     {r12}                   \n");   // pop flags into the temporary register r12
     msr12();                                            // restore flags
 
-if(Traits<FPU>::enabled && !Traits<FPU>::user_save)
+if(Traits<FPU>::enabled && !Traits<FPU>::user_save && !Traits<FPU>::lazy)
     ASM("       vpop   {s16-s31}                \n"     // restore FPU registers
         "       vpop   {s0-s15}                 \n");
 
@@ -80,4 +84,50 @@ if((Traits<Build>::MODEL == Traits<Build>::eMote3) || (Traits<Build>::MODEL == T
         ".ret:  bx      lr                      \n");   // return
 }
 
+// Lazy FPU switching: FPEXC.EN stays clear unless the running thread owns the
+// FPU, so its first VFP instruction after a switch is undefined and gets to
+// fpu_trap() (see IC::undefined_instruction())
+void CPU::fpu_switch(FPU_Context * prev, FPU_Context * next)
+{
+    unsigned int cpu = smp ? id() : 0;
+
+    // With SMP, threads can resume on another CPU, so the owner's state cannot stay behind
+    if(smp && prev && (_fpu_owner[cpu] == prev)) {
+        fpu_save(prev);
+        _fpu_owner[cpu] = 0;
+    }
+
+    _fpu_running[cpu] = next;
+    if(next && (_fpu_owner[cpu] == next))
+        fpu_enable();
+    else
+        fpu_disable();
+}
+
+bool CPU::fpu_trap()
+{
+    unsigned int cpu = smp ? id() : 0;
+    FPU_Context * running = _fpu_running[cpu];
+
+    if(!running || fpu_enabled())
+        return false;
+
+    fpu_enable();
+    if(_fpu_owner[cpu] != running) {
+        if(_fpu_owner[cpu])
+            fpu_save(_fpu_owner[cpu]);
+        fpu_restore(running);
+        _fpu_owner[cpu] = running;
+    }
+
+    return true;
+}
+
+void CPU::fpu_release(FPU_Context * ctx)
+{
+    for(unsigned int i = 0; i < Traits<Build>::CPUS; i++)
+        if(_fpu_owner[i] == ctx)
+            _fpu_owner[i] = 0;
+}
+
 __END_SYS
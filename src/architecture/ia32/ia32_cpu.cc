@@ -11,6 +11,8 @@ volatile unsigned int CPU::_cores;
 Hertz CPU::_cpu_clock;
 Hertz CPU::_cpu_current_clock;
 Hertz CPU::_bus_clock;
+CPU::FPU_Context * CPU::_fpu_owner[Traits<Build>::CPUS];
+CPU::FPU_Context * CPU::_fpu_running[Traits<Build>::CPUS];
 
 void CPU::Context::save() volatile
 {
@@ -95,4 +97,49 @@ unsigned int CPU::id() {
     return smp ? APIC::id() : 0;
 }
 
+// Lazy FPU switching: CR0.TS stays set unless the running thread owns the FPU,
+// so its first FPU instruction after a switch raises #NM and gets to fpu_trap()
+void CPU::fpu_switch(FPU_Context * prev, FPU_Context * next)
+{
+    unsigned int cpu = id();
+
+    // With SMP, threads can resume on another CPU, so the owner's state cannot stay behind
+    if(smp && prev && (_fpu_owner[cpu] == prev)) {
+        fpu_save(prev);
+        _fpu_owner[cpu] = 0;
+    }
+
+    _fpu_running[cpu] = next;
+    if(next && (_fpu_owner[cpu] == next))
+        fpu_enable();
+    else
+        fpu_disable();
+}
+
+bool CPU::fpu_trap()
+{
+    unsigned int cpu = id();
+    FPU_Context * running = _fpu_running[cpu];
+
+    if(!running || fpu_enabled())
+        return false;
+
+    fpu_enable();
+    if(_fpu_owner[cpu] != running) {
+        if(_fpu_owner[cpu])
+            fpu_save(_fpu_owner[cpu]);
+        fpu_restore(running);
+        _fpu_owner[cpu] = running;
+    }
+
+    return true;
+}
+
+void CPU::fpu_release(FPU_Context * ctx)
+{
+    for(unsigned int i = 0; i < Traits<Build>::CPUS; i++)
+        if(_fpu_owner[i] == ctx)
+            _fpu_owner[i] = 0;
+}
+
 __END_SYS
@@ -6,6 +6,7 @@ __BEGIN_SYS
 
 // Class attributes
 MMU::List MMU::_free[colorful * COLORS + 1];
+MMU::Buddy MMU::_buddy;
 MMU::Page_Directory * MMU::_master;
 
 __END_SYS
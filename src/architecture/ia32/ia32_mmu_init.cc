@@ -20,10 +20,9 @@ void MMU::init()
     db<Init, MMU>(INF) << "MMU::free3={base=" << reinterpret_cast<void *>(si->pmm.free3_base) << ",size="
                        << (si->pmm.free3_top - si->pmm.free3_base) / 1024 << "KB}" << endl;
 
-    // BIG NOTE HERE: INIT (i.e. this program) will be part of the free
-    // storage after the following is executed, but it will remain alive
-    // This only works because the _free.insert_merging() only
-    // touches the first page of each chunk and INIT is not there
+    // BIG NOTE HERE: INIT (i.e. this program) lies within the second free
+    // chunk, but the buddy allocator writes to the first page of every free
+    // block it forms, so INIT's pages are kept out of the free storage
 
     if(colorful) {
         int f1b = si->pmm.free1_base;
@@ -66,7 +65,7 @@ void MMU::init()
                 f3b = f3t = 0;
             }
         }
-        if((size > 0) || (_free[WHITE].grouped_size() * MMU::PAGE_SIZE < Traits<System>::HEAP_SIZE))
+        if((size > 0) || (_buddy.available() < Traits<System>::HEAP_SIZE))
             db<Init, MMU>(ERR) << "MMU::int: System's heap size (Traits<System>::HEAP_SIZE=" << Traits<System>::HEAP_SIZE << ") is larger than memory!" << endl;
 
         // Insert the remaining free memory into the _free[color] lists
@@ -88,10 +87,19 @@ void MMU::init()
             frame += MMU::PAGE_SIZE;
         }
     } else {
-        // Insert all free memory into the _free[WHITE] list
-        free(si->pmm.free1_base, pages(si->pmm.free1_top - si->pmm.free1_base));
-        free(si->pmm.free2_base, pages(si->pmm.free2_top - si->pmm.free2_base));
-        free(si->pmm.free3_base, pages(si->pmm.free3_top - si->pmm.free3_base));
+        // Insert all free memory but INIT into the WHITE buddy allocator
+        white_free(si->pmm.free1_base, pages(si->pmm.free1_top - si->pmm.free1_base));
+        if(si->lm.has_ini) {
+            unsigned int ini_base = si->lm.ini_code & ~(sizeof(Page) - 1);
+            unsigned int ini_top = align_page(si->lm.ini_data_size ? si->lm.ini_data + si->lm.ini_data_size : si->lm.ini_code + si->lm.ini_code_size);
+            if((ini_base >= si->pmm.free2_base) && (ini_top <= si->pmm.free2_top)) {
+                white_free(si->pmm.free2_base, pages(ini_base - si->pmm.free2_base));
+                white_free(ini_top, pages(si->pmm.free2_top - ini_top));
+            } else
+                white_free(si->pmm.free2_base, pages(si->pmm.free2_top - si->pmm.free2_base));
+        } else
+            white_free(si->pmm.free2_base, pages(si->pmm.free2_top - si->pmm.free2_base));
+        white_free(si->pmm.free3_base, pages(si->pmm.free3_top - si->pmm.free3_base));
     }
 
     // Remember the master page directory (created during SETUP)
@@ -8,6 +8,9 @@ __BEGIN_SYS
 // Class attributes
 unsigned int CPU::_cpu_clock;
 unsigned int CPU::_bus_clock;
+CPU::FPU_Context * CPU::_fpu_owner[Traits<Build>::CPUS];
+CPU::FPU_Context * CPU::_fpu_running[Traits<Build>::CPUS];
+bool CPU::_fpu_dirty[Traits<Build>::CPUS];
 
 // Class methods
 void CPU::Context::save() volatile
@@ -156,4 +159,137 @@ void CPU::switch_context(Context ** o, Context * n)
         ".ret:  jalr     x0,     (x1)           \n");   // return (for the thread leaving the CPU)
 }
 
+void CPU::fpu_save(FPU_Context * ctx)
+{
+    ASM("       fsd      f0,   0(%0)            \n"
+        "       fsd      f1,   8(%0)            \n"
+        "       fsd      f2,  16(%0)            \n"
+        "       fsd      f3,  24(%0)            \n"
+        "       fsd      f4,  32(%0)            \n"
+        "       fsd      f5,  40(%0)            \n"
+        "       fsd      f6,  48(%0)            \n"
+        "       fsd      f7,  56(%0)            \n"
+        "       fsd      f8,  64(%0)            \n"
+        "       fsd      f9,  72(%0)            \n"
+        "       fsd     f10,  80(%0)            \n"
+        "       fsd     f11,  88(%0)            \n"
+        "       fsd     f12,  96(%0)            \n"
+        "       fsd     f13, 104(%0)            \n"
+        "       fsd     f14, 112(%0)            \n"
+        "       fsd     f15, 120(%0)            \n"
+        "       fsd     f16, 128(%0)            \n"
+        "       fsd     f17, 136(%0)            \n"
+        "       fsd     f18, 144(%0)            \n"
+        "       fsd     f19, 152(%0)            \n"
+        "       fsd     f20, 160(%0)            \n"
+        "       fsd     f21, 168(%0)            \n"
+        "       fsd     f22, 176(%0)            \n"
+        "       fsd     f23, 184(%0)            \n"
+        "       fsd     f24, 192(%0)            \n"
+        "       fsd     f25, 200(%0)            \n"
+        "       fsd     f26, 208(%0)            \n"
+        "       fsd     f27, 216(%0)            \n"
+        "       fsd     f28, 224(%0)            \n"
+        "       fsd     f29, 232(%0)            \n"
+        "       fsd     f30, 240(%0)            \n"
+        "       fsd     f31, 248(%0)            \n" : : "r"(ctx->_f) : "memory");
+    ASM("       csrr    %0, fcsr                \n" : "=r"(ctx->_fcsr) : : );
+    fpu_enable(); // registers are now clean
+}
+
+void CPU::fpu_restore(FPU_Context * ctx)
+{
+    ASM("       fld      f0,   0(%0)            \n"
+        "       fld      f1,   8(%0)            \n"
+        "       fld      f2,  16(%0)            \n"
+        "       fld      f3,  24(%0)            \n"
+        "       fld      f4,  32(%0)            \n"
+        "       fld      f5,  40(%0)            \n"
+        "       fld      f6,  48(%0)            \n"
+        "       fld      f7,  56(%0)            \n"
+        "       fld      f8,  64(%0)            \n"
+        "       fld      f9,  72(%0)            \n"
+        "       fld     f10,  80(%0)            \n"
+        "       fld     f11,  88(%0)            \n"
+        "       fld     f12,  96(%0)            \n"
+        "       fld     f13, 104(%0)            \n"
+        "       fld     f14, 112(%0)            \n"
+        "       fld     f15, 120(%0)            \n"
+        "       fld     f16, 128(%0)            \n"
+        "       fld     f17, 136(%0)            \n"
+        "       fld     f18, 144(%0)            \n"
+        "       fld     f19, 152(%0)            \n"
+        "       fld     f20, 160(%0)            \n"
+        "       fld     f21, 168(%0)            \n"
+        "       fld     f22, 176(%0)            \n"
+        "       fld     f23, 184(%0)            \n"
+        "       fld     f24, 192(%0)            \n"
+        "       fld     f25, 200(%0)            \n"
+        "       fld     f26, 208(%0)            \n"
+        "       fld     f27, 216(%0)            \n"
+        "       fld     f28, 224(%0)            \n"
+        "       fld     f29, 232(%0)            \n"
+        "       fld     f30, 240(%0)            \n"
+        "       fld     f31, 248(%0)            \n" : : "r"(ctx->_f) : "memory");
+    ASM("       csrw    fcsr, %0                \n" : : "r"(ctx->_fcsr) : );
+    fpu_enable(); // registers are now clean
+}
+
+// Lazy FPU switching: mstatus.FS stays Off unless the running thread owns the
+// FPU, so its first FPU instruction after a switch is illegal and gets to
+// fpu_trap(). FS also tells whether the owner changed the registers since they
+// were loaded, so a clean owner is never saved.
+void CPU::fpu_switch(FPU_Context * prev, FPU_Context * next)
+{
+    unsigned int cpu = smp ? id() : 0;
+
+    if(prev && (_fpu_owner[cpu] == prev)) {
+        _fpu_dirty[cpu] = fpu_dirty();
+
+        // With SMP, threads can resume on another CPU, so the owner's state cannot stay behind
+        if(smp) {
+            if(_fpu_dirty[cpu])
+                fpu_save(prev);
+            _fpu_owner[cpu] = 0;
+            _fpu_dirty[cpu] = false;
+        }
+    }
+
+    _fpu_running[cpu] = next;
+    if(next && (_fpu_owner[cpu] == next))
+        fpu_enable(_fpu_dirty[cpu]);
+    else
+        fpu_disable();
+}
+
+bool CPU::fpu_trap()
+{
+    unsigned int cpu = smp ? id() : 0;
+    FPU_Context * running = _fpu_running[cpu];
+
+    if(!running || fpu_enabled())
+        return false;
+
+    if(_fpu_owner[cpu] != running) {
+        fpu_enable();
+        if(_fpu_owner[cpu] && _fpu_dirty[cpu])
+            fpu_save(_fpu_owner[cpu]);
+        fpu_restore(running);
+        _fpu_owner[cpu] = running;
+        _fpu_dirty[cpu] = false;
+    } else
+        fpu_enable(_fpu_dirty[cpu]);
+
+    return true;
+}
+
+void CPU::fpu_release(FPU_Context * ctx)
+{
+    for(unsigned int i = 0; i < Traits<Build>::CPUS; i++)
+        if(_fpu_owner[i] == ctx) {
+            _fpu_owner[i] = 0;
+            _fpu_dirty[i] = false;
+        }
+}
+
 __END_SYS
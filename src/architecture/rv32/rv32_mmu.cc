@@ -5,6 +5,11 @@
 __BEGIN_SYS
 
 // Class attributes
-MMU::List MMU::_free;
+No_MMU::List No_MMU::_free;
+
+Sv32_MMU::Buddy Sv32_MMU::_buddy;
+Sv32_MMU::Page_Directory * Sv32_MMU::_master;
+unsigned int Sv32_MMU::_asids;
+unsigned long Sv32_MMU::_asid_map[];
 
 __END_SYS
@@ -8,7 +8,7 @@ extern "C" void * _end;
 
 __BEGIN_SYS
 
-void MMU::init()
+void No_MMU::init()
 {
     db<Init, MMU>(TRC) << "MMU::init()" << endl;
 
@@ -22,5 +22,39 @@ void MMU::init()
     free(Memory_Map::MEM_TOP + 1 - Traits<Machine>::STACK_SIZE * Traits<Machine>::CPUS, pages(Traits<Machine>::STACK_SIZE * Traits<Machine>::CPUS));
 }
 
-__END_SYS
 
+void Sv32_MMU::init()
+{
+    db<Init, MMU>(TRC) << "MMU::init()" << endl;
+
+    db<Init, MMU>(INF) << "MMU::init::dat.e=" << &_edata << ",bss.b=" << &__bss_start << ",bss.e=" << &_end << endl;
+
+    // Only whole frames are taken. The buddy allocator writes to free blocks and hands out the highest ones first,
+    // so the BOOT stacks at the top of the memory, in use until the end of INIT, are left out (as SYS_STACK on RV64)
+    _buddy.add(reinterpret_cast<unsigned int>(&_end), Memory_Map::MEM_TOP + 1 - Traits<Machine>::STACK_SIZE * Traits<Machine>::CPUS - reinterpret_cast<unsigned int>(&_end));
+
+    // The master directory maps I/O and physical memory for everyone, but only in supervisor mode
+    _master = calloc(1);
+    identity(0, Memory_Map::MEM_BASE, Sv32_Flags::PIO | Sv32_Flags::G);
+    identity(Memory_Map::MEM_BASE, Memory_Map::MEM_TOP + 1UL, Sv32_Flags::SYS | Sv32_Flags::G);
+
+    // ASID bits not implemented read back as zeros
+    CPU::pdp(satp(_master, ASID_MASK));
+    _asids = ((CPU::pdp() >> ASID_SHIFT) & ASID_MASK) + 1;
+    if(_asids > ASIDS)
+        _asids = ASIDS;
+    CPU::pdp(satp(_master, 0));
+    flush_tlb();
+
+    db<Init, MMU>(INF) << "MMU::init: master=" << _master << ",asids=" << _asids << ",free=" << _buddy.available() / 1024 << "KB" << endl;
+}
+
+
+// Identity maps [from, to), which must be aligned to megapages, with megapages only
+void Sv32_MMU::identity(Phy_Addr from, Phy_Addr to, const Sv32_Flags & flags)
+{
+    for( ; from < to; from += MEGAPAGE)
+        (*_master)[directory(from)] = pte(from, flags);
+}
+
+__END_SYS
@@ -5,6 +5,11 @@
 __BEGIN_SYS
 
 // Class attributes
-MMU::List MMU::_free;
+No_MMU::List No_MMU::_free;
+
+Sv39_MMU::Buddy Sv39_MMU::_buddy;
+Sv39_MMU::Page_Directory * Sv39_MMU::_master;
+unsigned int Sv39_MMU::_asids;
+unsigned long Sv39_MMU::_asid_map[];
 
 __END_SYS
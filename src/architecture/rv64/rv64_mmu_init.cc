@@ -9,7 +9,7 @@ extern "C" void * _end;
 
 __BEGIN_SYS
 
-void MMU::init()
+void No_MMU::init()
 {
     db<Init, MMU>(TRC) << "MMU::init()" << endl;
 
@@ -20,5 +20,46 @@ void MMU::init()
     free(&_end, pages(Memory_Map::SYS_STACK - CPU::Log_Addr(&_end)));
 }
 
-__END_SYS
 
+void Sv39_MMU::init()
+{
+    db<Init, MMU>(TRC) << "MMU::init()" << endl;
+
+    // Only whole frames are taken (TODO: the stack left at the top of the memory for INIT is freed at Thread::init())
+    _buddy.add(CPU::Log_Addr(&_end), Memory_Map::SYS_STACK - CPU::Log_Addr(&_end));
+
+    // The master directory maps I/O and physical memory for everyone, but only in supervisor mode
+    _master = calloc(1);
+    identity(0, Memory_Map::MEM_BASE, Sv39_Flags::PIO | Sv39_Flags::G);
+    identity(Memory_Map::MEM_BASE, Memory_Map::MEM_TOP + 1UL, Sv39_Flags::SYS | Sv39_Flags::G);
+
+    // ASID bits not implemented read back as zeros
+    CPU::pdp(satp(_master, ASID_MASK));
+    _asids = ((CPU::pdp() >> ASID_SHIFT) & ASID_MASK) + 1;
+    if(_asids > ASIDS)
+        _asids = ASIDS;
+    CPU::pdp(satp(_master, 0));
+    flush_tlb();
+
+    db<Init, MMU>(INF) << "MMU::init: master=" << _master << ",asids=" << _asids << ",free=" << _buddy.available() / 1024 << "KB" << endl;
+}
+
+
+// Identity maps [from, to), which must be aligned to megapages, with gigapages wherever possible
+void Sv39_MMU::identity(Phy_Addr from, Phy_Addr to, const Sv39_Flags & flags)
+{
+    while(from < to) {
+        PT_Entry & root = (*_master)[(from >> ROOT_SHIFT) & (PT_ENTRIES - 1)];
+        if(!(from % GIGAPAGE) && (to - from >= GIGAPAGE)) {
+            root = pte(from, flags);
+            from += GIGAPAGE;
+        } else {
+            if(!(root & Sv39_Flags::V))
+                root = pte(calloc(1), Sv39_Flags::PTR | Sv39_Flags::G);
+            (*table(root))[(from >> DIRECTORY_SHIFT) & (PT_ENTRIES - 1)] = pte(from, flags);
+            from += MEGAPAGE;
+        }
+    }
+}
+
+__END_SYS
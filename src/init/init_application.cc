@@ -18,9 +18,18 @@ public:
     Init_Application() {
         db<Init>(TRC) << "Init_Application()" << endl;
 
+        // Application's heap is shared by all CPUs
+        if(Traits<System>::multicore && (CPU::id() != 0))
+            return;
+
         // Initialize Application's heap
         db<Init>(INF) << "Initializing application's heap" << endl;
-        Application::_heap = new (&Application::_preheap[0]) Heap(MMU::alloc(MMU::pages(HEAP_SIZE)), HEAP_SIZE);
+        void * heap = MMU::alloc(MMU::pages(HEAP_SIZE));
+        if(!heap) {
+            db<Init>(ERR) << "Init_Application: no room for the application's heap (" << HEAP_SIZE << " bytes)!" << endl;
+            Machine::panic();
+        }
+        Application::_heap = new (&Application::_preheap[0]) Heap(heap, HEAP_SIZE);
 
         db<Init>(INF) << "done!" << endl;
     }
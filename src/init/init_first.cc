@@ -20,6 +20,10 @@ public:
 
         db<Init, Thread>(INF) << "Dispatching the first thread: " << Thread::running() << endl;
 
+        // The FPU is handed to the first thread that uses it (see CPU::fpu_trap())
+        if(Thread::lazy_fpu)
+            CPU::fpu_switch(0, Thread::running()->_fpu);
+
         // Interrupts have been disable at Thread::init() and will be reenabled by CPU::Context::load()
         // but we first reset the timer to avoid getting a time interrupt during load()
         Timer::reset();
@@ -11,11 +11,22 @@ class Init_System
 {
 private:
     static const unsigned int HEAP_SIZE = Traits<System>::HEAP_SIZE;
+    static const unsigned int UNCACHED_HEAP_SIZE = Traits<System>::UNCACHED_HEAP_SIZE;
 
 public:
     Init_System() {
         db<Init>(TRC) << "Init_System()" << endl;
 
+        // Other CPUs wait for CPU 0 to set up the system's heap and the
+        // machine and then initialize only their own share of them
+        if(Traits<System>::multicore && (CPU::id() != 0)) {
+            CPU::init();
+            CPU::smp_barrier();
+            Machine::init();
+            System::init();
+            return;
+        }
+
         // Initialize the processor
         db<Init>(INF) << "Initializing the CPU: " << endl;
         CPU::init();
@@ -23,14 +34,37 @@ public:
 
         // Initialize System's heap
         db<Init>(INF) << "Initializing system's heap: " << endl;
-        System::_heap = new (&System::_preheap[0]) Heap(MMU::alloc(MMU::pages(HEAP_SIZE)), HEAP_SIZE);
+        void * heap = MMU::alloc(MMU::pages(HEAP_SIZE));
+        if(!heap) {
+            db<Init>(ERR) << "Init_System: no room for the system's heap (" << HEAP_SIZE << " bytes)!" << endl;
+            Machine::panic();
+        }
+        System::_heap = new (&System::_preheap[0]) Heap(heap, HEAP_SIZE);
         db<Init>(INF) << "done!" << endl;
 
+        // Initialize the heaps for new (SCRATCHPAD) and new (UNCACHED), if any
+        if(Traits<Scratchpad>::enabled) {
+            db<Init>(INF) << "Initializing scratchpad's heap: " << endl;
+            MMU::Chunk * chunk = new (SYSTEM) MMU::Chunk(Traits<Scratchpad>::ADDRESS, Traits<Scratchpad>::SIZE, MMU::Flags::SYS | MMU::Flags::CT | MMU::Flags::IO);
+            MMU::Directory dir(MMU::current());
+            System::_scratchpad_heap = new (&System::_scratchpad_preheap[0]) Heap(dir.attach(*chunk), Traits<Scratchpad>::SIZE);
+            db<Init>(INF) << "done!" << endl;
+        }
+        if(UNCACHED_HEAP_SIZE) {
+            db<Init>(INF) << "Initializing uncached heap: " << endl;
+            MMU::DMA_Buffer * buffer = new (SYSTEM) MMU::DMA_Buffer(UNCACHED_HEAP_SIZE);
+            System::_uncached_heap = new (&System::_uncached_preheap[0]) Heap(buffer->log_address(), UNCACHED_HEAP_SIZE);
+            db<Init>(INF) << "done!" << endl;
+        }
+
         // Initialize the machine
         db<Init>(INF) << "Initializing the machine: " << endl;
         Machine::init();
         db<Init>(INF) << "done!" << endl;
 
+        if(Traits<System>::multicore)
+            CPU::smp_barrier();
+
         // Initialize system abstractions
         db<Init>(INF) << "Initializing system abstractions: " << endl;
         System::init();
@@ -25,6 +25,13 @@ void IC::init()
     for(Interrupt_Id i = 0; i < INTS; i++)
         _int_vector[i] = int_not;
 
+    // All programmable priorities start at the same level, so nothing nests
+    // until set otherwise. SVCall is kept above them all for _int_exit.
+    if(nested)
+        for(Interrupt_Id i = ARMv7_M::EXC_MPU; i < INTS; i++)
+            if(i != ARMv7_M::EXC_SVCALL)
+                Engine::priority(i, PRIORITY_NORMAL);
+
     // Initialize eoi vector (must be done at runtime because of .hex image format)
     for(unsigned int i = 0; i < INTS; i++)
         _eoi_vector[i] = 0;
@@ -2,12 +2,14 @@
 
 #include <machine/machine.h>
 #include <machine/ic.h>
+#include <architecture/tsc.h>
 #include <machine/timer.h>
 #include <machine/usb.h>
 #include <machine/gpio.h>
+#include <interrupt.h>
 
 extern "C" { void _int_entry() __attribute__ ((alias("_ZN4EPOS1S2IC5entryEv"))); }
-extern "C" { void _dispatch(unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC8dispatchEj"))); }
+extern "C" { void _dispatch(unsigned int, unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC8dispatchEjj"))); }
 extern "C" { void _eoi(unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC3eoiEj"))); }
 extern "C" { void _undefined_instruction() __attribute__ ((alias("_ZN4EPOS1S2IC21undefined_instructionEv"))); }
 extern "C" { void _software_interrupt() __attribute__ ((alias("_ZN4EPOS1S2IC18software_interruptEv"))); }
@@ -20,6 +22,7 @@ __BEGIN_SYS
 
 // Class attributes
 IC::Interrupt_Handler IC::_int_vector[IC::INTS];
+IC::Latency IC::_latency[IC::histogram ? IC::INTS : 1];
 IC::Interrupt_Handler IC::_eoi_vector[INTS] = {
     0, // Reset
     0, // NMI
@@ -134,7 +137,7 @@ SP + 12  |Don't Care | (general purpose register 3)
          +-----------+
 SP +  8  |Don't Care | (general purpose register 2)
          +-----------+
-SP +  4  |Don't Care | (general purpose register 1)
+SP +  4  |BASEPRI    | (priority mask of the interrupted code, to be passed as argument to dispatch())
          +-----------+
 SP       |int_id     | (to be passed as argument to dispatch())
          +-----------+
@@ -143,10 +146,14 @@ And then load EXC_RETURN into pc. This will cause stack (2) to the popped up unt
 The stack will return to state (1) with the addition of EXC_RETURN, the processor will be in Thread mode, and
 the followingregisters of interest will be updated:
     r0 = int_id
+    r1 = BASEPRI
     pc = dispatch
     lr = exit
 
-Then dispatch(int_id) will be executed and return to _int_exit, which simply issues a supervisor call (SVC).
+If Traits<IC>::nested, eoi() raises BASEPRI to the priority of the interrupt while still in Handler mode,
+so dispatch() can only be preempted by interrupts of higher priority. dispatch() restores the mask in r1
+before returning.
+Then dispatch(int_id, BASEPRI) will be executed and return to _int_exit, which simply issues a supervisor call (SVC).
 The processor then enters handler mode and pushes a new stack like (1) to execute the SVC. The svc handler
 simply ignores this stack, sets the stack back to (1) and returns from the interrupt, making the processor
 restore the context it saved in (1).
@@ -172,16 +179,17 @@ void IC::entry()
 {
     ASM("   mrs     r0, xpsr           \n"
         "   and     r0, #0x3f          \n" // Store int_id in r0 (to be passed as argument to eoi() and dispatch())        
-        "   push    {r0, lr}           \n"
-        "   bl      _eoi               \n" // Acknowledge the interrupt
-        "   pop     {r0, lr}           \n"
-        "   mov     r3, #1             \n"
-        "   lsl     r3, #24            \n" // xPSR with Thumb bit only. Other bits are Don't Care
-        "   ldr     r1, =_int_exit     \n" // Fake LR (will cause _int_exit to execute after dispatch())
-        "   orr     r1, #1             \n"
-        "   ldr     r2, =_dispatch     \n" // Fake PC (will cause dispatch() to execute after entry())
-        "   sub     r2, #1             \n"
-        "   push    {r1-r3}            \n" // Fake stack (2): xPSR, PC, LR
+        "   mrs     r1, basepri        \n" // Store the interrupted mask in r1 (to be passed as argument to dispatch())
+        "   push    {r0-r2, lr}        \n" // r2 only keeps the stack 8-byte aligned
+        "   bl      _eoi               \n" // Acknowledge the interrupt (and mask its priority)
+        "   pop     {r0-r2, lr}        \n"
+        "   mov     r12, #1            \n"
+        "   lsl     r12, #24           \n" // xPSR with Thumb bit only. Other bits are Don't Care
+        "   ldr     r2, =_int_exit     \n" // Fake LR (will cause _int_exit to execute after dispatch())
+        "   orr     r2, #1             \n"
+        "   ldr     r3, =_dispatch     \n" // Fake PC (will cause dispatch() to execute after entry())
+        "   sub     r3, #1             \n"
+        "   push    {r2, r3, r12}      \n" // Fake stack (2): xPSR, PC, LR
         "   push    {r0-r3, r12}       \n" // Push rest of fake stack (2)
         "   isb                        \n"
         "   bx      lr                 \n" // Return from handler mode. Will proceed to dispatch()
@@ -202,12 +210,28 @@ void IC::entry()
                                             // And we're back to pre-interrupt code
 }
 
-void IC::dispatch(unsigned int id)
+void IC::dispatch(unsigned int id, unsigned int mask)
 {
     if((id != INT_SYS_TIMER) || Traits<IC>::hysterically_debugged)
         db<IC>(TRC) << "IC::dispatch(i=" << id << ")" << endl;
 
+    TSC::Time_Stamp start = histogram ? TSC::time_stamp() : 0;
+
     _int_vector[id](id);
+
+    if(histogram) {
+        CPU::int_disable();
+        _latency[id].sample(TSC::time_stamp() - start);
+        CPU::int_enable();
+    }
+
+    if(nested)
+        CPU::basepri(mask); // softirqs run under the interrupted mask
+
+    if(Traits<Softirq>::enabled) {
+        Softirq::drain();
+        CPU::int_enable(); // _int_exit can't issue SVC with interrupts disabled
+    }
 }
 
 void IC::eoi(unsigned int id)
@@ -219,6 +243,9 @@ void IC::eoi(unsigned int id)
 
     if(_eoi_vector[id])
         _eoi_vector[id](id);
+
+    if(nested)
+        Engine::mask(Engine::priority(id));
 }
 
 void IC::int_not(Interrupt_Id i)
@@ -19,6 +19,13 @@ void IC::init()
     for(Interrupt_Id i = 0; i < INTS; i++)
         _int_vector[i] = int_not;
 
+    // All programmable priorities start at the same level, so nothing nests
+    // until set otherwise. SVCall is kept above them all for _int_exit.
+    if(nested)
+        for(Interrupt_Id i = ARMv7_M::EXC_MPU; i < INTS; i++)
+            if(i != ARMv7_M::EXC_SVCALL)
+                Engine::priority(i, PRIORITY_NORMAL);
+
     _int_vector[IC::INT_HARD_FAULT] = hard_fault;
 
     // TSC is initialized before IC, so we register its interrupt now
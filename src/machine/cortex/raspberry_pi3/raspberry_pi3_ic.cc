@@ -2,11 +2,15 @@
 
 #include <machine/machine.h>
 #include <machine/ic.h>
+#include <architecture/tsc.h>
+#include <interrupt.h>
 
 extern "C" { void _int_entry() __attribute__ ((alias("_ZN4EPOS1S2IC5entryEv"))); }
-extern "C" { void _dispatch(unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC8dispatchEj"))); }
+extern "C" { void _dispatch(unsigned int, unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC8dispatchEjj"))); }
 extern "C" { void _eoi(unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC3eoiEj"))); }
 extern "C" { void _undefined_instruction() __attribute__ ((alias("_ZN4EPOS1S2IC21undefined_instructionEv"))); }
+extern "C" { void _undefined() __attribute__ ((alias("_ZN4EPOS1S2IC9undefinedEv"))); }
+extern "C" { bool _fpu_trap(); }
 extern "C" { void _software_interrupt() __attribute__ ((alias("_ZN4EPOS1S2IC18software_interruptEv"))); }
 extern "C" { void _prefetch_abort() __attribute__ ((alias("_ZN4EPOS1S2IC14prefetch_abortEv"))); }
 extern "C" { void _data_abort() __attribute__ ((alias("_ZN4EPOS1S2IC10data_abortEv"))); }
@@ -17,6 +21,7 @@ __BEGIN_SYS
 
 // Class attributes
 IC::Interrupt_Handler IC::_int_vector[IC::INTS];
+IC::Latency IC::_latency[IC::histogram ? IC::INTS : 1];
 
 
 // Class methods
@@ -55,7 +60,7 @@ void IC::entry()
         "ldmfd sp!, {r0-r3, r12, lr, pc}^           \n" : : "i"(dispatch));
 }
 
-void IC::dispatch(unsigned int i)
+void IC::dispatch(unsigned int i, unsigned int)
 {
     Interrupt_Id id = int_id();
 
@@ -66,9 +71,28 @@ void IC::dispatch(unsigned int i)
     if(_eoi_vector[id])
         _eoi_vector[id](id);
 
+    // int_id() has already dropped the running priority, so the priority
+    // mask is what keeps interrupts of the same and lower levels out
+    Priority old = mask();
+    if(nested)
+        Engine::mask(Engine::priority(id));
+
+    TSC::Time_Stamp start = histogram ? TSC::time_stamp() : 0;
+
     CPU::int_enable();
 
     _int_vector[id](id);
+
+    CPU::int_disable();
+
+    if(histogram)
+        _latency[id].sample(TSC::time_stamp() - start);
+
+    if(nested)
+        Engine::mask(old);
+
+    if(Traits<Softirq>::enabled)
+        Softirq::drain();
 }
 
 void IC::eoi(unsigned int id)
@@ -92,7 +116,44 @@ void IC::hard_fault(Interrupt_Id i)
     Machine::panic();
 }
 
+// VFP instructions are undefined while FPEXC.EN is clear (see CPU::fpu_trap()),
+// in which case they are restarted once the running thread owns the FPU
 void IC::undefined_instruction()
+{
+    ASM(".equ MODE_UND, 0x1b                        \n"
+        ".equ MODE_SVC, 0x13                        \n"
+        ".equ IRQ_BIT,  0x80                        \n"
+        ".equ FIQ_BIT,  0x40                        \n"
+        ".equ THUMB_BIT, 0x20                       \n"
+        // Go to SVC (UND has no stack)
+        "msr cpsr_c, #MODE_SVC | IRQ_BIT | FIQ_BIT  \n"
+        // Save current context (lr, sp and spsr are banked registers)
+        "stmfd sp!, {r0-r3, r12, lr, pc}            \n"
+        // Go to UND
+        "msr cpsr_c, #MODE_UND | IRQ_BIT | FIQ_BIT  \n"
+        // Pass und_spsr to SVC r1
+        "mrs r1, spsr                               \n"
+        // Return to the undefined instruction itself (lr is 4 bytes past it in ARM state and 2 in Thumb)
+        "tst r1, #THUMB_BIT                         \n"
+        "subeq r0, lr, #4                           \n"
+        "subne r0, lr, #2                           \n"
+        // Go back to SVC
+        "msr cpsr_c, #MODE_SVC | IRQ_BIT | FIQ_BIT  \n"
+        // sp+24 is the position of the saved pc
+        "str r0, [sp, #24]                          \n"
+        // Save UND-spsr
+        "stmfd sp!, {r1}                            \n"
+        "bl _fpu_trap                               \n"
+        "cmp r0, #0                                 \n"
+        "beq _undefined                             \n"
+        "ldmfd sp!, {r0}                            \n"
+        // Restore UND's spsr value to SVC's spsr
+        "msr spsr_cfxs, r0                          \n"
+        // Restore context, the ^ makes spsr to be restored into cpsr
+        "ldmfd sp!, {r0-r3, r12, lr, pc}^           \n");
+}
+
+void IC::undefined()
 {
     db<IC>(ERR) << "Undefined instruction" << endl;
     Machine::panic();
@@ -2,9 +2,11 @@
 
 #include <machine/machine.h>
 #include <machine/ic.h>
+#include <architecture/tsc.h>
+#include <interrupt.h>
 
 extern "C" { void _int_entry() __attribute__ ((alias("_ZN4EPOS1S2IC5entryEv"))); }
-extern "C" { void _dispatch(unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC8dispatchEj"))); }
+extern "C" { void _dispatch(unsigned int, unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC8dispatchEjj"))); }
 extern "C" { void _eoi(unsigned int) __attribute__ ((alias("_ZN4EPOS1S2IC3eoiEj"))); }
 extern "C" { void _undefined_instruction() __attribute__ ((alias("_ZN4EPOS1S2IC21undefined_instructionEv"))); }
 extern "C" { void _software_interrupt() __attribute__ ((alias("_ZN4EPOS1S2IC18software_interruptEv"))); }
@@ -17,6 +19,7 @@ __BEGIN_SYS
 
 // Class attributes
 IC::Interrupt_Handler IC::_int_vector[IC::INTS];
+IC::Latency IC::_latency[IC::histogram ? IC::INTS : 1];
 
 
 // Class methods
@@ -55,7 +58,7 @@ void IC::entry()
         "ldmfd sp!, {r0-r3, r12, lr, pc}^           \n" : : "i"(dispatch));
 }
 
-void IC::dispatch(unsigned int i)
+void IC::dispatch(unsigned int i, unsigned int)
 {
     Interrupt_Id id = int_id();
 
@@ -66,9 +69,28 @@ void IC::dispatch(unsigned int i)
     if(_eoi_vector[id])
         _eoi_vector[id](id);
 
+    // int_id() has already dropped the running priority, so the priority
+    // mask is what keeps interrupts of the same and lower levels out
+    Priority old = mask();
+    if(nested)
+        Engine::mask(Engine::priority(id));
+
+    TSC::Time_Stamp start = histogram ? TSC::time_stamp() : 0;
+
     CPU::int_enable();
 
     _int_vector[id](id);
+
+    CPU::int_disable();
+
+    if(histogram)
+        _latency[id].sample(TSC::time_stamp() - start);
+
+    if(nested)
+        Engine::mask(old);
+
+    if(Traits<Softirq>::enabled)
+        Softirq::drain();
 }
 
 void IC::eoi(unsigned int id)
@@ -120,6 +120,11 @@ void IC::init()
     // Set all interrupt handlers to int_not()
     for(Interrupt_Id i = 0; i < INTS; i++)
         _int_vector[i] = int_not;
+
+    // All interrupts start at the same priority, so nothing nests until set otherwise
+    if(nested)
+        for(Interrupt_Id i = 0; i < INTS; i++)
+            Engine::priority(i, PRIORITY_NORMAL);
 }
 
 __END_SYS
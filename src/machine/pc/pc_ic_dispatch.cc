@@ -2,6 +2,7 @@
 
 #include <machine/ic.h>
 #include <process.h>
+#include <interrupt.h>
 
 __BEGIN_SYS
 
@@ -16,6 +17,9 @@ void IC::dispatch(unsigned int i)
             db<IC>(TRC) << "IC::dispatch(i=" << i << ")" << endl;
 
         _int_vector[i](i);
+
+        if(Traits<Softirq>::enabled)
+            Softirq::drain();
     } else {
         if(i != INT_LAST_HARD)
             db<IC>(TRC) << "IC::spurious interrupt (" << i << ")" << endl;
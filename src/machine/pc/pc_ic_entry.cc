@@ -835,6 +835,17 @@ void IC::exc_gpf(Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error)
     _exit(-1);
 }
 
+// Device not available (#NM), raised by FPU instructions while CR0.TS is set (see CPU::fpu_trap())
+void IC::exc_nodev()
+{
+    ASM("        pushal                 \n"
+        "        call   %P0             \n"
+        "        testb  %%al, %%al      \n"
+        "        popal                  \n"
+        "        jz     %P1             \n"
+        "        iret                   \n" : : "i"(&CPU::fpu_trap), "i"(&exc_fpu));
+}
+
 void IC::exc_fpu(Reg32 eip, Reg32 cs, Reg32 eflags, Reg32 error)
 {
     db<IC,Machine>(WRN) << "IC::exc_fpu(cs=" << hex << cs << ",ip=" << reinterpret_cast<void *>(eip) << ",fl=" << eflags << ")" << endl;
@@ -23,7 +23,10 @@ void IC::init()
     idt[CPU::EXC_PF]     = CPU::IDT_Entry(CPU::SEL_SYS_CODE, Log_Addr(&exc_pf),  CPU::SEG_IDT_ENTRY);
     idt[CPU::EXC_DOUBLE] = CPU::IDT_Entry(CPU::SEL_SYS_CODE, Log_Addr(&exc_pf),  CPU::SEG_IDT_ENTRY);
     idt[CPU::EXC_GPF]    = CPU::IDT_Entry(CPU::SEL_SYS_CODE, Log_Addr(&exc_gpf), CPU::SEG_IDT_ENTRY);
-    idt[CPU::EXC_NODEV]  = CPU::IDT_Entry(CPU::SEL_SYS_CODE, Log_Addr(&exc_fpu), CPU::SEG_IDT_ENTRY);
+    if(Traits<FPU>::enabled && Traits<FPU>::lazy)
+        idt[CPU::EXC_NODEV] = CPU::IDT_Entry(CPU::SEL_SYS_CODE, Log_Addr(&exc_nodev), CPU::SEG_IDT_ENTRY);
+    else
+        idt[CPU::EXC_NODEV] = CPU::IDT_Entry(CPU::SEL_SYS_CODE, Log_Addr(&exc_fpu), CPU::SEG_IDT_ENTRY);
 
     // Install the syscall trap handler
     if(Traits<Build>::MODE == Traits<Build>::KERNEL)
@@ -2,6 +2,7 @@
 
 #include <machine/machine.h>
 #include <machine/ic.h>
+#include <interrupt.h>
 
 extern "C" { void _int_entry() __attribute__ ((alias("_ZN4EPOS1S2IC5entryEv"))); }
 
@@ -13,98 +14,120 @@ IC::Interrupt_Handler IC::_int_vector[IC::INTS];
 // Class methods
 void IC::entry()
 {
-    // Handle interrupts in machine mode
-    ASM("        .align 4                                               \n"
+    // Handle interrupts in machine mode, with mtvec in vectored mode: each
+    // interrupt cause has its own slot in the table below, so its id is known
+    // without decoding mcause, while exceptions (and direct mode) share slot 0.
+    // Only the registers the ABI leaves to the caller are saved, since
+    // dispatch() preserves the others and CPU::switch_context() saves the
+    // whole context of a thread when a handler happens to switch threads.
+    ASM("        .align 6                                               \n"
+        "        .global _int_vector_table                              \n"
+        "_int_vector_table:                                             \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .msi                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .mti                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .mei                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
+        "        j          .exc                                        \n"
         "                                                               \n"
-        "# Save context                                                 \n"
-        "        addi        sp,     sp,   -140                         \n"          // 32 regs of 4 bytes each = 128 Bytes
-        "        sw          x1,   4(sp)                                \n"
-        "        sw          x2,   8(sp)                                \n"
-        "        sw          x3,  12(sp)                                \n"
-        "        sw          x4,  16(sp)                                \n"
-        "        sw          x5,  20(sp)                                \n"
-        "        sw          x6,  24(sp)                                \n"
-        "        sw          x7,  28(sp)                                \n"
-        "        sw          x8,  32(sp)                                \n"
-        "        sw          x9,  36(sp)                                \n"
-        "        sw         x10,  40(sp)                                \n"
-        "        sw         x11,  44(sp)                                \n"
-        "        sw         x12,  48(sp)                                \n"
-        "        sw         x13,  52(sp)                                \n"
-        "        sw         x14,  56(sp)                                \n"
-        "        sw         x15,  60(sp)                                \n"
-        "        sw         x16,  64(sp)                                \n"
-        "        sw         x17,  68(sp)                                \n"
-        "        sw         x18,  72(sp)                                \n"
-        "        sw         x19,  76(sp)                                \n"
-        "        sw         x20,  80(sp)                                \n"
-        "        sw         x21,  84(sp)                                \n"
-        "        sw         x22,  88(sp)                                \n"
-        "        sw         x23,  92(sp)                                \n"
-        "        sw         x24,  96(sp)                                \n"
-        "        sw         x25, 100(sp)                                \n"
-        "        sw         x26, 104(sp)                                \n"
-        "        sw         x27, 108(sp)                                \n"
-        "        sw         x28, 112(sp)                                \n"
-        "        sw         x29, 116(sp)                                \n"
-        "        sw         x30, 120(sp)                                \n"
-        "        sw         x31, 124(sp)                                \n"
+        "# Exceptions and other interrupts decode mcause                \n"
+        ".exc:                                                          \n"
+        "        addi        sp,     sp,    -80                         \n"
+        "        sw         x10,  16(sp)                                \n"
+        "        csrr       x10, mcause                                 \n"
+        "        bgez       x10, .save                                  \n" // exception: the id is the cause
+        "        slli       x10, x10,     1                             \n" // interrupt: clear the interrupt bit
+        "        srli       x10, x10,     1                             \n"
+        "        addi       x10, x10,    %1                             \n"
+        "        j          .save                                       \n"
+        "                                                               \n"
+        "# Machine software, timer and external interrupts              \n"
+        ".msi:                                                          \n"
+        "        addi        sp,     sp,    -80                         \n"
+        "        sw         x10,  16(sp)                                \n"
+        "        li         x10, %3                                     \n"
+        "        j          .save                                       \n"
+        "                                                               \n"
+        ".mti:                                                          \n"
+        "        addi        sp,     sp,    -80                         \n"
+        "        sw         x10,  16(sp)                                \n"
+        "        li         x10, %4                                     \n"
+        "        j          .save                                       \n"
+        "                                                               \n"
+        ".mei:                                                          \n"
+        "        addi        sp,     sp,    -80                         \n"
+        "        sw         x10,  16(sp)                                \n"
+        "        li         x10, %5                                     \n"
+        "        j          .save                                       \n"
+        "                                                               \n"
+        "# Save the caller-saved context                                \n"
+        ".save:                                                         \n"
+        "        sw          x1,   0(sp)                                \n"
+        "        sw          x5,   4(sp)                                \n"
+        "        sw          x6,   8(sp)                                \n"
+        "        sw          x7,  12(sp)                                \n"
+        "        sw         x11,  20(sp)                                \n"
+        "        sw         x12,  24(sp)                                \n"
+        "        sw         x13,  28(sp)                                \n"
+        "        sw         x14,  32(sp)                                \n"
+        "        sw         x15,  36(sp)                                \n"
+        "        sw         x16,  40(sp)                                \n"
+        "        sw         x17,  44(sp)                                \n"
+        "        sw         x28,  48(sp)                                \n"
+        "        sw         x29,  52(sp)                                \n"
+        "        sw         x30,  56(sp)                                \n"
+        "        sw         x31,  60(sp)                                \n"
         "        csrr       x31, mie                                    \n"
-        "        sw         x31, 128(sp)                                \n"
+        "        sw         x31,  64(sp)                                \n"
         "        csrr       x31, mstatus                                \n"
-        "        sw         x31, 132(sp)                                \n"
+        "        li         x30, %2                                     \n" // leave FS out, since it belongs to whichever thread runs
+        "        and        x31, x31, x30                               \n" // when this frame is restored (see CPU::fpu_switch())
+        "        sw         x31,  68(sp)                                \n"
         "        csrr       x31, mepc                                   \n"
-        "        sw         x31, 136(sp)                                \n"
+        "        sw         x31,  72(sp)                                \n"
         "        la          ra, .restore                               \n" // Set LR to restore context before returning
-        "        j          %0                                          \n"
+        "        j          %0                                          \n" // dispatch(id), with id in a0
         "                                                               \n"
         "# Restore context                                              \n"
         ".restore:                                                      \n"
-        "        lw          x1,   4(sp)                                \n"
-        "        lw          x2,   8(sp)                                \n"
-        "        lw          x3,  12(sp)                                \n"
-        "        lw          x4,  16(sp)                                \n"
-        "        lw          x5,  20(sp)                                \n"
-        "        lw          x6,  24(sp)                                \n"
-        "        lw          x7,  28(sp)                                \n"
-        "        lw          x8,  32(sp)                                \n"
-        "        lw          x9,  36(sp)                                \n"
-        "        lw         x10,  40(sp)                                \n"
-        "        lw         x11,  44(sp)                                \n"
-        "        lw         x12,  48(sp)                                \n"
-        "        lw         x13,  52(sp)                                \n"
-        "        lw         x14,  56(sp)                                \n"
-        "        lw         x15,  60(sp)                                \n"
-        "        lw         x16,  64(sp)                                \n"
-        "        lw         x17,  68(sp)                                \n"
-        "        lw         x18,  72(sp)                                \n"
-        "        lw         x19,  76(sp)                                \n"
-        "        lw         x20,  80(sp)                                \n"
-        "        lw         x21,  84(sp)                                \n"
-        "        lw         x22,  88(sp)                                \n"
-        "        lw         x23,  92(sp)                                \n"
-        "        lw         x24,  96(sp)                                \n"
-        "        lw         x25, 100(sp)                                \n"
-        "        lw         x26, 104(sp)                                \n"
-        "        lw         x27, 108(sp)                                \n"
-        "        lw         x28, 112(sp)                                \n"
-        "        lw         x29, 116(sp)                                \n"
-        "        lw         x30, 120(sp)                                \n"
-        "        lw         x31, 124(sp)                                \n"
-        "        lw         x31, 128(sp)                                \n"
+        "        lw         x31,  64(sp)                                \n"
         "        csrs       mie, x31                                    \n"
-        "        lw         x31, 132(sp)                                \n"
+        "        lw         x31,  68(sp)                                \n"
         "        csrs   mstatus, x31                                    \n"
-        "        lw         x31, 136(sp)                                \n"
+        "        lw         x31,  72(sp)                                \n"
         "        csrw      mepc, x31                                    \n"
-        "        addi        sp, sp,    140                             \n"
-        "        mret                                                   \n" : : "i"(&dispatch));
+        "        lw          x1,   0(sp)                                \n"
+        "        lw          x5,   4(sp)                                \n"
+        "        lw          x6,   8(sp)                                \n"
+        "        lw          x7,  12(sp)                                \n"
+        "        lw         x10,  16(sp)                                \n"
+        "        lw         x11,  20(sp)                                \n"
+        "        lw         x12,  24(sp)                                \n"
+        "        lw         x13,  28(sp)                                \n"
+        "        lw         x14,  32(sp)                                \n"
+        "        lw         x15,  36(sp)                                \n"
+        "        lw         x16,  40(sp)                                \n"
+        "        lw         x17,  44(sp)                                \n"
+        "        lw         x28,  48(sp)                                \n"
+        "        lw         x29,  52(sp)                                \n"
+        "        lw         x30,  56(sp)                                \n"
+        "        lw         x31,  60(sp)                                \n"
+        "        addi        sp, sp,     80                             \n"
+        "        mret                                                   \n" : : "i"(&dispatch), "i"(HARD_INT), "i"(~CPU::FS), "i"(INT_RESCHEDULER), "i"(INT_SYS_TIMER), "i"(HARD_INT + IRQ_MAC_EXT));
 }
 
-void IC::dispatch()
+void IC::dispatch(Interrupt_Id id)
 {
-    Interrupt_Id id = int_id();
-
     if((id != INT_SYS_TIMER) || Traits<IC>::hysterically_debugged)
         db<IC>(TRC) << "IC::dispatch(i=" << id << ")" << endl;
 
@@ -112,6 +135,9 @@ void IC::dispatch()
         IC::ipi_eoi(id);
 
     _int_vector[id](id);
+
+    if(Traits<Softirq>::enabled)
+        Softirq::drain();
 }
 
 void IC::int_not(Interrupt_Id id)
@@ -125,6 +151,10 @@ void IC::int_not(Interrupt_Id id)
 
 void IC::exception(Interrupt_Id id)
 {
+    // FPU instructions are illegal while mstatus.FS is Off (see CPU::fpu_trap())
+    if(Traits<FPU>::enabled && Traits<FPU>::lazy && (id == CPU::EXC_IILLEGAL) && CPU::fpu_trap())
+        return;
+
     CPU::Reg mstatus = CPU::mstatus();
     CPU::Reg mcause = CPU::mcause();
     CPU::Reg mhartid = CPU::id();
@@ -11,6 +11,26 @@ Timer * Timer::_channels[CHANNELS];
 // Class methods
 void Timer::int_handler(Interrupt_Id i)
 {
+    if(tickless) {
+        // Channels are updated and MTIMECMP reprogrammed before any handler is
+        // called, since handlers might cause a context switch
+        Time_Stamp now = TSC::time_stamp();
+        bool due[CHANNELS];
+        for(unsigned int c = 0; c < CHANNELS; c++) {
+            Timer * t = _channels[c];
+            due[c] = t && t->_deadline && (now >= t->_deadline);
+            if(due[c])
+                t->_deadline = t->_retrigger ? now + t->period() : 0;
+        }
+        compare();
+
+        for(unsigned int c = 0; c < CHANNELS; c++)
+            if(due[c] && _channels[c])
+                _channels[c]->_handler(i);
+
+        return;
+    }
+
     config(FREQUENCY);
     if(_channels[SCHEDULER] && (--_channels[SCHEDULER]->_current[CPU::id()] <= 0)) {
         _channels[SCHEDULER]->_current[CPU::id()] = _channels[SCHEDULER]->_initial;
@@ -441,8 +441,12 @@ void PC_Setup::build_pmm()
     // = NP/NPTE_PT * sizeof(Page)
     //   NP = size of physical memory in pages
     //   NPTE_PT = number of page table entries per page table
+    // With large pages, only the last 4 MB, if partial, needs a page table
     unsigned int mem_size = MMU::pages(si->bm.mem_top - si->bm.mem_base);
-    top_page -= (mem_size + MMU::PT_ENTRIES - 1) / MMU::PT_ENTRIES;
+    if(Traits<MMU>::large_pages)
+        top_page -= (mem_size % MMU::PT_ENTRIES) ? 1 : 0;
+    else
+        top_page -= (mem_size + MMU::PT_ENTRIES - 1) / MMU::PT_ENTRIES;
     si->pmm.phy_mem_pts = top_page * sizeof(Page);
 
     // Page tables to map the IO address space
@@ -575,6 +579,10 @@ void PC_Setup::enable_paging()
     // Set CR3 (PDBR) register
     CPU::cr3(si->pmm.sys_pd);
 
+    // Enable 4 MB pages, which the system page directory uses to map physical memory
+    if(Traits<MMU>::large_pages)
+        CPU::cr4(CPU::cr4() | CPU::CR4_PSE);
+
     // Enable paging
     Reg32 aux = CPU::cr0();
     aux &= CPU::CR0_CLEAR;
@@ -743,20 +751,38 @@ void PC_Setup::setup_sys_pd()
     unsigned int mem_size = MMU::pages(si->bm.mem_top - si->bm.mem_base);
     int n_pts = (mem_size + MMU::PT_ENTRIES - 1) / MMU::PT_ENTRIES;
 
-    // Map all physical memory into the page tables pointed by phy_mem_pts
-    // These will be attached at both PHY_MEM and MEM_BASE thus flags
-    // must consider application access
     PT_Entry * pts = reinterpret_cast<PT_Entry *>((void *)si->pmm.phy_mem_pts);
-    for(unsigned int i = MMU::pages(si->pmm.mem_base); i < mem_size; i++)
-        pts[i] = (i * sizeof(Page)) | Flags::APP;
-
-    // Attach all physical memory starting at PHY_MEM
-    for(int i = 0; i < n_pts; i++)
-        sys_pd[MMU::directory(PHY_MEM) + i] = (si->pmm.phy_mem_pts + i * sizeof(Page)) | Flags::SYS;
-
-    // Attach memory starting at MEM_BASE
-    for(unsigned int i = MMU::directory(MMU::align_directory(si->pmm.mem_base)); i < MMU::directory(MMU::align_directory(si->pmm.mem_top)); i++)
-        sys_pd[i] = (si->pmm.phy_mem_pts + i * sizeof(Page)) | Flags::APP;
+    if(Traits<MMU>::large_pages) {
+        // Map every whole 4 MB of physical memory with a large page and only
+        // the last, partial one (if any) into the page table at phy_mem_pts
+        int n_lps = mem_size / MMU::PT_ENTRIES;
+        if(n_lps < n_pts)
+            memset(pts, 0, sizeof(Page));
+        for(unsigned int i = n_lps * MMU::PT_ENTRIES; i < mem_size; i++)
+            pts[i - n_lps * MMU::PT_ENTRIES] = (i * sizeof(Page)) | Flags::APP;
+
+        // Attach all physical memory starting at PHY_MEM
+        for(int i = 0; i < n_pts; i++)
+            sys_pd[MMU::directory(PHY_MEM) + i] = (i < n_lps) ? (i * sizeof(Page) * MMU::PT_ENTRIES) | Flags::SYS | Flags::PS : si->pmm.phy_mem_pts | Flags::SYS;
+
+        // Attach memory starting at MEM_BASE
+        for(int i = MMU::directory(MMU::align_directory(si->pmm.mem_base)); (i < int(MMU::directory(MMU::align_directory(si->pmm.mem_top)))) && (i < n_pts); i++)
+            sys_pd[i] = (i < n_lps) ? (i * sizeof(Page) * MMU::PT_ENTRIES) | Flags::APP | Flags::PS : si->pmm.phy_mem_pts | Flags::APP;
+    } else {
+        // Map all physical memory into the page tables pointed by phy_mem_pts
+        // These will be attached at both PHY_MEM and MEM_BASE thus flags
+        // must consider application access
+        for(unsigned int i = MMU::pages(si->pmm.mem_base); i < mem_size; i++)
+            pts[i] = (i * sizeof(Page)) | Flags::APP;
+
+        // Attach all physical memory starting at PHY_MEM
+        for(int i = 0; i < n_pts; i++)
+            sys_pd[MMU::directory(PHY_MEM) + i] = (si->pmm.phy_mem_pts + i * sizeof(Page)) | Flags::SYS;
+
+        // Attach memory starting at MEM_BASE
+        for(unsigned int i = MMU::directory(MMU::align_directory(si->pmm.mem_base)); i < MMU::directory(MMU::align_directory(si->pmm.mem_top)); i++)
+            sys_pd[i] = (si->pmm.phy_mem_pts + i * sizeof(Page)) | Flags::APP;
+    }
 
     // Calculate the number of page tables needed to map the IO address space
     unsigned int io_size = MMU::pages(si->pmm.io_top - si->pmm.io_base);
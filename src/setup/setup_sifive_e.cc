@@ -17,9 +17,9 @@ void _setup()
         # Disable paging                                                        \t\n\
         csrw    sptbr, zero                                                     \t\n\
                                                                                 \t\n\
-        # Put CLINT in direct mode (mtvec.mode = 0) and set mtvec to _int_entry \t\n\
-        la      t0, _int_entry                                                  \t\n\
-        andi    t0, t0, 0xfffffffe  # mtvec.mode = 0                            \t\n\
+        # Put CLINT in vectored mode (mtvec.mode = 1) with IC's vector table    \t\n\
+        la      t0, _int_vector_table                                           \t\n\
+        ori     t0, t0, 1           # mtvec.mode = 1                            \t\n\
         csrw    mtvec, t0                                                       \t\n\
                                                                                 \t\n\
         # Get the hart's id                                                     \t\n\
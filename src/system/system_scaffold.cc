@@ -29,5 +29,9 @@ OStream kerr;
 System_Info * System::_si = reinterpret_cast<System_Info *>(Memory_Map::SYS_INFO);
 char System::_preheap[];
 Heap * System::_heap;
+char System::_scratchpad_preheap[];
+Heap * System::_scratchpad_heap;
+char System::_uncached_preheap[];
+Heap * System::_uncached_heap;
 
 __END_SYS
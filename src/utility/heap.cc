@@ -7,11 +7,18 @@ extern "C" { void _panic(); }
 __BEGIN_UTIL
 
 // Methods
-void Heap::out_of_memory()
+void Simple_Heap::out_of_memory()
 {
     db<Heaps>(ERR) << "Heap::alloc(this=" << this << "): out of memory!" << endl;
 
     _panic();
 }
 
+void TLSF_Heap::out_of_memory()
+{
+    db<Heaps>(ERR) << "TLSF_Heap::alloc(this=" << this << "): out of memory!" << endl;
+
+    _panic();
+}
+
 __END_UTIL